@@ -38,3 +38,15 @@ Result srvUnregisterService(const char* name);
  * @param notificationIdOut Pointer to output the ID of the received notification to.
  */
 Result srvReceiveNotification(u32* notificationIdOut);
+
+/**
+ * @brief Subscribes to a notification.
+ * @param notificationId ID of the notification.
+ */
+Result srvSubscribe(u32 notificationId);
+
+/**
+ * @brief Unsubscribes from a notification.
+ * @param notificationId ID of the notification.
+ */
+Result srvUnsubscribe(u32 notificationId);
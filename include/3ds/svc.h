@@ -26,6 +26,13 @@ static inline u32* getThreadCommandBuffer(void)
 	return (u32*)((u8*)getThreadLocalStorage() + 0x80);
 }
 
+/// Reset types (for use with events and timers)
+typedef enum {
+	RESET_ONESHOT = 0, ///< When the primitive is signaled, it will wake up exactly one thread and will clear itself automatically.
+	RESET_STICKY  = 1, ///< When the primitive is signaled, it will wake up all threads and it won't clear itself automatically.
+	RESET_PULSE   = 2, ///< Only meaningful for timers: same as ONESHOT but it will periodically signal the timer instead of just once.
+} ResetType;
+
 /**
  * @brief Gets the ID of a process.
  * @param[out] out Pointer to output the process ID to.
@@ -84,6 +91,46 @@ Result svcBindInterrupt(u32 interruptId, Handle eventOrSemaphore, s32 priority,
  */
 Result svcUnbindInterrupt(u32 interruptId, Handle eventOrSemaphore);
 
+/**
+ * @brief Creates an event handle.
+ * @param[out] event Pointer to output the created event handle to.
+ * @param reset_type Type of reset the event uses (RESET_ONESHOT/RESET_STICKY).
+ */
+Result svcCreateEvent(Handle* event, ResetType reset_type);
+
+/**
+ * @brief Signals an event.
+ * @param handle Handle of the event to signal.
+ */
+Result svcSignalEvent(Handle handle);
+
+/**
+ * @brief Creates a timer.
+ * @param[out] timer Pointer to output the handle of the created timer to.
+ * @param reset_type Type of reset to perform on the timer.
+ */
+Result svcCreateTimer(Handle* timer, ResetType reset_type);
+
+/**
+ * @brief Sets a timer.
+ * @param timer Handle of the timer to set.
+ * @param initial Initial value of the timer.
+ * @param interval Interval of the timer.
+ */
+Result svcSetTimer(Handle timer, s64 initial, s64 interval);
+
+/**
+ * @brief Cancels a timer.
+ * @param timer Handle of the timer to cancel.
+ */
+Result svcCancelTimer(Handle timer);
+
+/**
+ * @brief Gets the current system tick.
+ * @return The current system tick.
+ */
+u64 svcGetSystemTick(void);
+
 /**
  * @brief Closes a handle.
  * @param handle Handle to close.
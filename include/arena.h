@@ -0,0 +1,80 @@
+#pragma once
+#include <stddef.h>
+#include <3ds/types.h>
+
+// memory for state that scales with configuration, the module has no heap
+// an arena is a bump allocator over storage placed in .bss.arena, never freed
+// pools are carved from an arena once and hand out fixed size objects, O(1) alloc and free
+
+// storage has to be declared with this, so it's cleared along with the rest of .bss and easy to find in the map
+#define ARENA_STORAGE __attribute__((section(".bss.arena"), aligned(8)))
+
+#define ARENA_ALIGN(size) (((size) + 7) & ~(size_t)7)
+// arena bytes a pool of count objects of type takes, for compile time budgets
+#define ARENA_POOL_SIZE(count, type) ((count) * ARENA_ALIGN(sizeof(type) > sizeof(void*) ? sizeof(type) : sizeof(void*)))
+
+typedef struct {
+	u8* base;
+	size_t size;
+	size_t used;
+} Arena;
+
+typedef struct {
+	void* free; // free objects, linked through their first word
+	u16 count;
+	u16 used;
+	u16 high_water;
+} Pool;
+
+inline static void Arena_Init(Arena* arena, void* storage, size_t size) {
+	arena->base = (u8*)storage;
+	arena->size = size;
+	arena->used = 0;
+}
+
+// 8 byte aligned, NULL once out of space
+inline static void* Arena_Alloc(Arena* arena, size_t size) {
+	size = ARENA_ALIGN(size);
+	if (size > arena->size - arena->used)
+		return NULL;
+	void* ptr = arena->base + arena->used;
+	arena->used += size;
+	return ptr;
+}
+
+inline static bool Pool_Init(Pool* pool, Arena* arena, size_t object_size, u16 count) {
+	if (object_size < sizeof(void*))
+		object_size = sizeof(void*);
+	object_size = ARENA_ALIGN(object_size);
+
+	u8* objects = (u8*)Arena_Alloc(arena, object_size * count);
+	if (!objects && count)
+		return false;
+
+	pool->free = NULL;
+	for (u16 i = count; i > 0; i--) {
+		void** object = (void**)(objects + (i - 1) * object_size);
+		*object = pool->free;
+		pool->free = object;
+	}
+	pool->count = count;
+	pool->used = 0;
+	pool->high_water = 0;
+	return true;
+}
+
+inline static void* Pool_Alloc(Pool* pool) {
+	void** object = (void**)pool->free;
+	if (!object)
+		return NULL;
+	pool->free = *object;
+	if (++pool->used > pool->high_water)
+		pool->high_water = pool->used;
+	return object;
+}
+
+inline static void Pool_Free(Pool* pool, void* object) {
+	*(void**)object = pool->free;
+	pool->free = object;
+	pool->used--;
+}
@@ -43,6 +43,9 @@
 // Max possible binds
 #define GPIO_BIND_MAX 19
 
+// Max possible remote sessions
+#define GPIO_SESSION_MAX 7
+
 // Service allowed access bits
 #define GPIO_CDC_MASK          (GPIO_MASK6      | GPIO_MASK3)
 #define GPIO_MCU_MASK          (GPIO_WIFI_STATE | GPIO_MASK15  | GPIO_MASK5)
@@ -61,6 +64,61 @@
 #define GPIO_ACCESS_REG4 (GPIO_ACCESS_REG3)
 #define GPIO_ACCESS_REG5 (GPIO_MASK18)
 
+// Bits each IPC function accepts, unions of the categories above
+#define GPIO_REGPART1_BITS       (GPIO_ACCESS_REG1 | GPIO_ACCESS_REG3)
+#define GPIO_REGPART2_BITS       (GPIO_ACCESS_REG1 | GPIO_ACCESS_REG4)
+#define GPIO_INTERRUPT_MASK_BITS (GPIO_ACCESS_REG1 | GPIO_ACCESS_REG4)
+#define GPIO_GET_DATA_BITS       (GPIO_ACCESS_REG0 | GPIO_ACCESS_REG1 | GPIO_ACCESS_REG2 | GPIO_ACCESS_REG3 | GPIO_ACCESS_REG5)
+#define GPIO_SET_DATA_BITS       (GPIO_ACCESS_REG1 | GPIO_ACCESS_REG2 | GPIO_ACCESS_REG3 | GPIO_ACCESS_REG5)
+
+// Bits GPIO_MaskToInterrupt can resolve, dead masks excluded
+#define GPIO_BINDABLE_BITS (GPIO_MASK17 | GPIO_MASK16 | GPIO_MASK15 | GPIO_MASK14 | GPIO_MASK13 | GPIO_MASK12 | GPIO_MASK11 | \
+                            GPIO_MASK10 | GPIO_MASK9  | GPIO_MASK8  | GPIO_MASK7  | GPIO_MASK6  | GPIO_MASK3)
+
+// Feature flags reported by GetCapabilities
+#define GPIO_FEATURE_IR_MASK_GE_V2048 BIT(0) // gpio:IR uses GPIO_IR_MASK_GE_V2048, else GPIO_IR_MASK_GE_V0
+#define GPIO_FEATURE_SLEEP_RESTORE    BIT(1) // registers are saved on sleep and restored on wake
+#define GPIO_FEATURE_STATE_SNAPSHOT   BIT(2) // GetState with change generation
+#define GPIO_FEATURE_TRANSACTIONS     BIT(3) // Begin/CommitTransaction write combining
+#define GPIO_FEATURE_NONFATAL_ERRORS  BIT(4) // client caused failures drop the session instead of the module, GetClientErrors
+#define GPIO_FEATURE_PWM              BIT(5) // SetPWM software PWM on output bits
+#define GPIO_FEATURE_PIN_STATS        BIT(6) // SetMeasure/GetPinStats edge counters
+#define GPIO_FEATURE_PIN_GROUPS       BIT(7) // pre-validated pin groups for GPIO data
+#define GPIO_FEATURE_SEQUENCER        BIT(8) // RunSequence timed write/wait scripts
+#define GPIO_FEATURE_RATE_LIMIT       BIT(9) // per session request budget, GetRateStats
+#define GPIO_FEATURE_MEMORY_STATS     BIT(10) // GetMemoryStats arena and pool high water marks
+#define GPIO_FEATURE_TRIGGERS         BIT(11) // Add/Remove/GetTrigger multi pin pattern triggers
+#define GPIO_FEATURE_BOOT_PROFILE     BIT(12) // a non-empty build time boot profile was applied, GetBootProfile
+
+// Sequencer script encoding, first word of each op is opcode and GPIO mask
+// SET:        op, value                  GPIO data of mask set to value
+// WAIT:       op, microseconds           mask unused
+// WAIT_LEVEL: op, value, timeout in us   waits until GPIO data of mask equals value
+#define GPIO_SEQ_MAX_WORDS 32
+
+#define GPIO_SEQ_OP_SET        0x1
+#define GPIO_SEQ_OP_WAIT       0x2
+#define GPIO_SEQ_OP_WAIT_LEVEL 0x3
+
+#define GPIO_SEQ_OP(op, mask)  (((u32)(op) << 28) | ((mask) & (BIT(GPIO_BIND_MAX) - 1)))
+#define GPIO_SEQ_GET_OP(word)   ((word) >> 28)
+#define GPIO_SEQ_GET_MASK(word) ((word) & (BIT(GPIO_BIND_MAX) - 1))
+
+// Sequencer states reported by GetSequenceStatus
+#define GPIO_SEQ_IDLE    0
+#define GPIO_SEQ_RUNNING 1
+#define GPIO_SEQ_DONE    2
+#define GPIO_SEQ_FAILED  3
+
+// Trigger modes, the condition is (GPIO data & mask) == pattern
+// the mask needs at least one bit with an interrupt, bits without one (GPIO_HID_PAD0) are only read when those toggle
+#define GPIO_TRIGGER_EDGE  0 // signaled when the condition becomes true
+#define GPIO_TRIGGER_LEVEL 1 // signaled when it becomes true or false, and on add if already true
+
+// GetTrigger flags, AddTrigger fails with GPIO_BUSY while a trigger would be blind from the start
+#define GPIO_TRIGGER_BLIND BIT(0) // clients have every interrupt bit of the mask bound, no changes are seen
+#define GPIO_TRIGGER_LOST  BIT(1) // was blind at some point since added, changes may have been missed
+
 // Result values
 #define GPIO_NOT_AUTHORIZED MAKERESULT(RL_USAGE, RS_INVALIDARG, RM_GPIO, RD_NOT_AUTHORIZED)
 #define GPIO_BUSY           MAKERESULT(RL_USAGE, RS_INVALIDARG, RM_GPIO, RD_BUSY)
@@ -69,3 +127,6 @@
 // Result values, my additions edition:tm:
 #define GPIO_INTERNAL_RANGE MAKERESULT(RL_FATAL, RS_INTERNAL, RM_GPIO, RD_OUT_OF_RANGE)
 #define GPIO_CANCELED_RANGE MAKERESULT(RL_FATAL, RS_CANCELED, RM_GPIO, RD_OUT_OF_RANGE)
+#define GPIO_NO_TRANSACTION MAKERESULT(RL_USAGE, RS_INVALIDSTATE, RM_GPIO, RD_NOT_INITIALIZED)
+#define GPIO_OUT_OF_RANGE   MAKERESULT(RL_USAGE, RS_INVALIDARG,   RM_GPIO, RD_OUT_OF_RANGE)
+#define GPIO_TIMEOUT        MAKERESULT(RL_TEMPORARY, RS_WOULDBLOCK, RM_GPIO, RD_TIMEOUT)
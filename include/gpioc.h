@@ -0,0 +1,79 @@
+/**
+ * @file gpioc.h
+ * @brief Client side of the gpio services, with cached configuration and coalesced writes.
+ *
+ * Not built into the module, add source/gpioc/gpioc.c to the client's own sources.
+ * The cache assumes the session is the only writer of its bits,
+ * bits shared between services (GPIO_WIFI_STATE, GPIO_MASK5, GPIO_MASK6, GPIO_MASK9) can go stale, GPIOC_Refresh resyncs them.
+ */
+#pragma once
+
+#include <3ds/types.h>
+#include <gpio.h>
+
+typedef struct {
+	u32 known; ///< Bits with a cached value.
+	u32 value; ///< Cached values, only valid under known.
+} GPIOC_Cache;
+
+typedef struct {
+	u32 mask;  ///< Bits waiting to be sent.
+	u32 value; ///< Values for those bits.
+} GPIOC_Pending;
+
+typedef struct {
+	Handle session;
+	u32 service_bitmask;  ///< Reported by GetCapabilities, 0 if the module doesn't have it.
+	u32 features;         ///< GPIO_FEATURE_* flags, 0 on stock gpio.
+	u32 generation;       ///< Last GetState generation, 0 if never refreshed.
+	bool batching;        ///< Set* calls are held back until GPIOC_Flush.
+	GPIOC_Cache regpart1;
+	GPIOC_Cache regpart2;
+	GPIOC_Cache interrupt_mask;
+	GPIOC_Pending pending_regpart1;
+	GPIOC_Pending pending_regpart2;
+	GPIOC_Pending pending_interrupt_mask;
+	GPIOC_Pending pending_data;
+} GPIOC_Client;
+
+/**
+ * @brief Initializes a client over an already opened gpio:* session.
+ * @param client Client to initialize.
+ * @param session Session handle, still owned by the caller.
+ *
+ * Asks the module for its capabilities, missing support is not an error.
+ */
+Result GPIOC_Init(GPIOC_Client* client, Handle session);
+
+/**
+ * @brief Refreshes every cached view in one request.
+ *
+ * Uses GetState when the module has it, nothing is re-read when the generation didn't change.
+ */
+Result GPIOC_Refresh(GPIOC_Client* client);
+
+/// Holds Set* calls back so consecutive writes to the same view go out as one request.
+void GPIOC_BeginBatch(GPIOC_Client* client);
+
+/**
+ * @brief Sends everything held back and leaves batching.
+ *
+ * Data goes first, then RegPart1, RegPart2 and the interrupt mask last,
+ * so outputs have their level before being switched on and nothing fires off half set state.
+ */
+Result GPIOC_Flush(GPIOC_Client* client);
+
+Result GPIOC_GetRegPart1(GPIOC_Client* client, u32 mask, u32* value);
+Result GPIOC_SetRegPart1(GPIOC_Client* client, u32 mask, u32 value);
+Result GPIOC_GetRegPart2(GPIOC_Client* client, u32 mask, u32* value);
+Result GPIOC_SetRegPart2(GPIOC_Client* client, u32 mask, u32 value);
+Result GPIOC_GetInterruptMask(GPIOC_Client* client, u32 mask, u32* value);
+Result GPIOC_SetInterruptMask(GPIOC_Client* client, u32 mask, u32 value);
+
+/// Input data is never cached, pending data writes are flushed first.
+Result GPIOC_GetGPIOData(GPIOC_Client* client, u32 mask, u32* value);
+Result GPIOC_SetGPIOData(GPIOC_Client* client, u32 mask, u32 value);
+
+/// Pending writes are flushed first, the event handle is only shared with the module.
+Result GPIOC_BindInterrupt(GPIOC_Client* client, u32 mask, Handle event, s32 priority);
+Result GPIOC_UnbindInterrupt(GPIOC_Client* client, u32 mask, Handle event);
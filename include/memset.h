@@ -2,6 +2,11 @@
 #include <stdint.h>
 #include <stddef.h>
 
+// dest and src word aligned, size doesn't need to be
+// MEMSET_SIZE_OPTIMIZED keeps the plain word loops, otherwise the stm burst ones in source/memset.s are used
+
+#ifdef MEMSET_SIZE_OPTIMIZED
+
 inline static void _memset32_aligned(void* dest, uint32_t c, size_t size) {
 	uint32_t *_dest = (uint32_t*)dest;
 	for (; size >= 4; size -= 4) {
@@ -14,3 +19,35 @@ inline static void _memset32_aligned(void* dest, uint32_t c, size_t size) {
 		_dest8++;
 	}
 }
+
+inline static void _memcpy32_aligned(void* dest, const void* src, size_t size) {
+	uint32_t *_dest = (uint32_t*)dest;
+	const uint32_t *_src = (const uint32_t*)src;
+	for (; size >= 4; size -= 4) {
+		*_dest = *_src;
+		_dest++;
+		_src++;
+	}
+	uint8_t *_dest8 = (uint8_t*)_dest;
+	const uint8_t *_src8 = (const uint8_t*)_src;
+	for (; size > 0; size--) {
+		*_dest8 = *_src8;
+		_dest8++;
+		_src8++;
+	}
+}
+
+#else
+
+void _memset32_burst(void* dest, uint32_t c, size_t size);
+void _memcpy32_burst(void* dest, const void* src, size_t size);
+
+inline static void _memset32_aligned(void* dest, uint32_t c, size_t size) {
+	_memset32_burst(dest, c, size);
+}
+
+inline static void _memcpy32_aligned(void* dest, const void* src, size_t size) {
+	_memcpy32_burst(dest, src, size);
+}
+
+#endif
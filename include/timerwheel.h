@@ -0,0 +1,55 @@
+#pragma once
+#include <stddef.h>
+#include <3ds/types.h>
+
+// hierarchical timer wheel, all times in system ticks
+// nodes live inside their owner, add and cancel are O(1), nothing is allocated
+// one kernel timer is enough to drive it: arm it for TimerWheel_Next, call TimerWheel_Advance when it fires
+
+// wheel tick is 1 << 14 system ticks, about 61us, deadlines are rounded up to it so nothing runs early
+#define TIMER_WHEEL_TICK_SHIFT 14
+#define TIMER_WHEEL_LEVEL_BITS 5
+#define TIMER_WHEEL_SLOTS      (1 << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_LEVELS     4
+// about 64 seconds, later deadlines are parked in the last level and cascaded again until they're in range
+
+#define TimerWheel_Entry(node, type, member) ((type*)((u8*)(node) - offsetof(type, member)))
+
+typedef struct TimerNode {
+	struct TimerNode* next;
+	struct TimerNode** pprev; // NULL while not pending
+	void (*callback)(struct TimerNode* node);
+	u64 expires; // in wheel ticks
+	u8 level;
+	u8 slot;
+} TimerNode;
+
+typedef struct {
+	TimerNode* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+	u32 occupied[TIMER_WHEEL_LEVELS];
+	u64 now; // in wheel ticks
+} TimerWheel;
+
+inline static void TimerNode_Init(TimerNode* node, void (*callback)(TimerNode* node)) {
+	node->pprev = NULL;
+	node->callback = callback;
+}
+
+inline static bool TimerNode_Pending(const TimerNode* node) {
+	return node->pprev != NULL;
+}
+
+void TimerWheel_Init(TimerWheel* wheel, u64 now);
+
+// a pending node is moved, deadlines already passed run on the next wheel tick
+void TimerWheel_Add(TimerWheel* wheel, TimerNode* node, u64 deadline);
+
+// no-op when not pending
+void TimerWheel_Cancel(TimerWheel* wheel, TimerNode* node);
+
+// runs every callback due by now, callbacks can add and cancel any node, including their own
+void TimerWheel_Advance(TimerWheel* wheel, u64 now);
+
+// next time TimerWheel_Advance has work to do, U64_MAX when empty
+// can be a cascade boundary before the actual deadline, so at most one early wake up per level
+u64 TimerWheel_Next(const TimerWheel* wheel);
@@ -110,3 +110,29 @@ Result srvReceiveNotification(u32* notificationIdOut)
 
 	return cmdbuf[1];
 }
+
+Result srvSubscribe(u32 notificationId)
+{
+	Result rc = 0;
+	u32* cmdbuf = getThreadCommandBuffer();
+
+	cmdbuf[0] = IPC_MakeHeader(0x9,1,0); // 0x90040
+	cmdbuf[1] = notificationId;
+
+	if(R_FAILED(rc = svcSendSyncRequest(srvHandle)))return rc;
+
+	return cmdbuf[1];
+}
+
+Result srvUnsubscribe(u32 notificationId)
+{
+	Result rc = 0;
+	u32* cmdbuf = getThreadCommandBuffer();
+
+	cmdbuf[0] = IPC_MakeHeader(0xA,1,0); // 0xA0040
+	cmdbuf[1] = notificationId;
+
+	if(R_FAILED(rc = svcSendSyncRequest(srvHandle)))return rc;
+
+	return cmdbuf[1];
+}
@@ -18,11 +18,51 @@ SVC_BEGIN svcSleepThread
 	bx  lr
 SVC_END svcSleepThread
 
+SVC_BEGIN svcCreateEvent
+	str r0, [sp, #-4]!
+	svc 0x17
+	ldr r2, [sp], #4
+	str r1, [r2]
+	bx  lr
+SVC_END svcCreateEvent
+
+SVC_BEGIN svcSignalEvent
+	svc 0x18
+	bx  lr
+SVC_END svcSignalEvent
+
+SVC_BEGIN svcCreateTimer
+	str r0, [sp, #-4]!
+	svc 0x1A
+	ldr r2, [sp], #4
+	str r1, [r2]
+	bx  lr
+SVC_END svcCreateTimer
+
+SVC_BEGIN svcSetTimer
+	str r4, [sp, #-4]!
+	ldr r1, [sp, #4]
+	ldr r4, [sp, #8]
+	svc 0x1B
+	ldr r4, [sp], #4
+	bx  lr
+SVC_END svcSetTimer
+
+SVC_BEGIN svcCancelTimer
+	svc 0x1C
+	bx  lr
+SVC_END svcCancelTimer
+
 SVC_BEGIN svcCloseHandle
 	svc 0x23
 	bx  lr
 SVC_END svcCloseHandle
 
+SVC_BEGIN svcGetSystemTick
+	svc 0x28
+	bx  lr
+SVC_END svcGetSystemTick
+
 SVC_BEGIN svcConnectToPort
 	str r0, [sp, #-0x4]!
 	svc 0x2D
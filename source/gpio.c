@@ -7,6 +7,8 @@
 #include <gpio.h>
 #include <err.h>
 #include <memset.h>
+#include <timerwheel.h>
+#include <arena.h>
 
 #define OS_REMOTE_SESSION_CLOSED MAKERESULT(RL_STATUS,    RS_CANCELED, RM_OS, 26)
 #define OS_INVALID_HEADER        MAKERESULT(RL_PERMANENT, RS_WRONGARG, RM_OS, 47)
@@ -15,13 +17,141 @@
 static const char* const GPIO_ServiceNames[] = {"gpio:CDC", "gpio:MCU", "gpio:HID", "gpio:NWM", "gpio:IR", "gpio:NFC", "gpio:QTM"};
 static const u32 GPIO_ServiceBitmasks_V2048[] = {GPIO_CDC_MASK, GPIO_MCU_MASK, GPIO_HID_MASK, GPIO_NWM_MASK, GPIO_IR_MASK_GE_V2048, GPIO_NFC_MASK, GPIO_QTM_MASK};
 static const u32 GPIO_ServiceBitmasks_V0[] = {GPIO_CDC_MASK, GPIO_MCU_MASK, GPIO_HID_MASK, GPIO_NWM_MASK, GPIO_IR_MASK_GE_V0};
+
+// per session request budget, same order as GPIO_ServiceNames, rate 0 is unlimited
+// far above what the system modules ask for, only there so a single client can't keep the module busy
+typedef struct {
+	u16 rate;  // requests per second
+	u16 burst; // requests served back to back before the rate applies, at least 1
+} GPIO_RateLimit;
+
+static const GPIO_RateLimit GPIO_ServiceRateLimits[] = {{1000, 32}, {1000, 32}, {1000, 32}, {1000, 32}, {1000, 32}, {1000, 32}, {1000, 32}};
+
+// configuration applied in one pass at startup, in the same bit space as the Set* requests
+// a zero mask leaves that view as the hardware comes up, clients can read it back with GetBootProfile
+// supplied at build time per firmware variant, either directly or from GPIO_BOOT_PROFILE_HEADER, as
+// regpart1_mask, regpart1, regpart2_mask, regpart2, interrupt_mask_mask, interrupt_mask, data_mask, data
+// e.g. #define GPIO_BOOT_PROFILE_V2048 0, 0, 0, 0, 0, 0, GPIO_MASK5, GPIO_MASK5
+#ifdef GPIO_BOOT_PROFILE_HEADER
+#include GPIO_BOOT_PROFILE_HEADER
+#endif
+#ifndef GPIO_BOOT_PROFILE_V2048
+#define GPIO_BOOT_PROFILE_V2048 0, 0, 0, 0, 0, 0, 0, 0
+#endif
+#ifndef GPIO_BOOT_PROFILE_V0
+#define GPIO_BOOT_PROFILE_V0 0, 0, 0, 0, 0, 0, 0, 0
+#endif
+
+#define GPIO_ALL_MASK_V2048 (GPIO_CDC_MASK | GPIO_MCU_MASK | GPIO_HID_MASK | GPIO_NWM_MASK | GPIO_IR_MASK_GE_V2048 | GPIO_NFC_MASK | GPIO_QTM_MASK)
+#define GPIO_ALL_MASK_V0    (GPIO_CDC_MASK | GPIO_MCU_MASK | GPIO_HID_MASK | GPIO_NWM_MASK | GPIO_IR_MASK_GE_V0)
+
+// indirection so the profile macros are expanded into separate arguments
+#define GPIO_BOOT_PROFILE_VALID(bitmask, ...) GPIO_BOOT_PROFILE_VALID_(bitmask, __VA_ARGS__)
+#define GPIO_BOOT_PROFILE_VALID_(bitmask, rp1_mask, rp1, rp2_mask, rp2, int_mask, ints, data_mask, data) \
+	(!((rp1_mask) & ~((bitmask) & GPIO_REGPART1_BITS)) && !((rp1) & ~(rp1_mask)) && \
+	!((rp2_mask) & ~((bitmask) & GPIO_REGPART2_BITS)) && !((rp2) & ~(rp2_mask)) && \
+	!((int_mask) & ~((bitmask) & GPIO_INTERRUPT_MASK_BITS)) && !((ints) & ~(int_mask)) && \
+	!((data_mask) & ~((bitmask) & GPIO_SET_DATA_BITS)) && !((data) & ~(data_mask)))
+
+_Static_assert(GPIO_BOOT_PROFILE_VALID(GPIO_ALL_MASK_V2048, GPIO_BOOT_PROFILE_V2048), "GPIO_BOOT_PROFILE_V2048 has bits no service can set");
+_Static_assert(GPIO_BOOT_PROFILE_VALID(GPIO_ALL_MASK_V0, GPIO_BOOT_PROFILE_V0), "GPIO_BOOT_PROFILE_V0 has bits no service can set");
+
+typedef struct {
+	u32 regpart1_mask;
+	u32 regpart1;
+	u32 regpart2_mask;
+	u32 regpart2;
+	u32 interrupt_mask_mask;
+	u32 interrupt_mask;
+	u32 data_mask;
+	u32 data;
+} GPIO_BootProfile;
+
+static const GPIO_BootProfile GPIO_BootProfile_V2048 = {GPIO_BOOT_PROFILE_V2048};
+static const GPIO_BootProfile GPIO_BootProfile_V0 = {GPIO_BOOT_PROFILE_V0};
+static const GPIO_BootProfile* GPIO_ActiveBootProfile;
 static __attribute__((section(".data.TerminationFlag"))) bool TerminationFlag = false;
+static u32 GPIO_Features = GPIO_FEATURE_SLEEP_RESTORE | GPIO_FEATURE_STATE_SNAPSHOT | GPIO_FEATURE_TRANSACTIONS | GPIO_FEATURE_PWM | GPIO_FEATURE_PIN_STATS | GPIO_FEATURE_PIN_GROUPS | GPIO_FEATURE_SEQUENCER | GPIO_FEATURE_RATE_LIMIT | GPIO_FEATURE_MEMORY_STATS | GPIO_FEATURE_TRIGGERS;
+
+// PTM sleep notifications, only delivered once subscribed through srv
+#define PTM_NOTIFICATION_GOING_TO_SLEEP  0x104
+#define PTM_NOTIFICATION_FULLY_WAKING_UP 0x105
+#define PTM_NOTIFICATION_HALF_AWAKE      0x107
+
+static const u32 GPIO_SleepNotifications[] = {PTM_NOTIFICATION_GOING_TO_SLEEP, PTM_NOTIFICATION_FULLY_WAKING_UP, PTM_NOTIFICATION_HALF_AWAKE};
+
+// REG1 mixes data, direction and edge bits with interrupt enables, same shift as GPIO_SetInterruptMask
+#define GPIO_REG1_INTERRUPT_BITS (GPIO_ACCESS_REG1 << 21)
+
+// every writable register word, so wake up is one pass and clients don't have to configure again
+typedef struct {
+	u32 reg1;
+	u32 reg3;
+	u32 reg4;
+	u16 reg2;
+	u16 reg5;
+	bool valid;
+} GPIO_SleepSnapshot;
+
+static GPIO_SleepSnapshot GPIO_SleepState;
+
+inline static void GPIO_SleepSave() {
+	GPIO_SleepState.reg1 = GPIO_REG1;
+	GPIO_SleepState.reg2 = GPIO_REG2;
+	GPIO_SleepState.reg3 = GPIO_REG3;
+	GPIO_SleepState.reg4 = GPIO_REG4;
+	GPIO_SleepState.reg5 = GPIO_REG5;
+	GPIO_SleepState.valid = true;
+}
+
+// the module keeps serving requests while asleep, so a pending snapshot follows every register write
+// otherwise wake up would revert whatever a client set in the meantime
+inline static void GPIO_SleepRefresh() {
+	if (GPIO_SleepState.valid)
+		GPIO_SleepSave();
+}
+
+// bumped on every configuration or output change, 0 is never used so clients can start with it
+static u32 GPIO_Generation = 1;
+
+inline static void GPIO_Changed() {
+	if (!++GPIO_Generation)
+		GPIO_Generation = 1;
+	GPIO_SleepRefresh();
+}
+
+// outputs and direction first, interrupt setup last, so nothing fires off half restored state
+// REG1 goes in twice, its interrupt enables only after REG4 has the rest of the interrupt setup
+// both wake notifications may arrive, only the first one restores
+inline static void GPIO_WakeRestore() {
+	if (!GPIO_SleepState.valid)
+		return;
+	GPIO_SleepState.valid = false;
+	GPIO_REG2 = GPIO_SleepState.reg2;
+	GPIO_REG5 = GPIO_SleepState.reg5;
+	GPIO_REG3 = GPIO_SleepState.reg3;
+	GPIO_REG1 = GPIO_SleepState.reg1 & ~GPIO_REG1_INTERRUPT_BITS;
+	GPIO_REG4 = GPIO_SleepState.reg4;
+	GPIO_REG1 = GPIO_SleepState.reg1;
+	// whatever a client cached may not be what was just restored
+	GPIO_Changed();
+}
 
 inline static void HandleSRVNotification() {
 	u32 id;
 	Err_FailedThrow(srvReceiveNotification(&id));
-	if (id == 0x100)
+	switch (id) {
+	case 0x100:
 		TerminationFlag = true;
+		break;
+	case PTM_NOTIFICATION_GOING_TO_SLEEP:
+		GPIO_SleepSave();
+		break;
+	case PTM_NOTIFICATION_FULLY_WAKING_UP:
+	case PTM_NOTIFICATION_HALF_AWAKE:
+		GPIO_WakeRestore();
+		break;
+	}
 }
 
 // reset maybe?
@@ -79,6 +209,222 @@ inline static void GPIO_StoreBind(Handle bind, u8 bit) {
 	GPIO_BindHandleStoreUsage |= BIT(bit);
 }
 
+// writes staged per register in register bit space, REG0 is input only
+typedef struct {
+	u32 mask[5];
+	u32 value[5];
+} GPIO_Transaction;
+
+// GPIO data access for a fixed mask, validated and translated once at creation
+// a step per register touched: register bits and the shift from register to pin bits
+#define GPIO_PIN_GROUP_MAX 4
+
+typedef struct {
+	uptr io;
+	u32 io_mask;
+	s8 left_shift;
+	bool wide;
+} GPIO_PinGroupStep;
+
+typedef struct {
+	u32 mask;
+	u8 step_count;
+	bool writable;
+	GPIO_PinGroupStep steps[5];
+} GPIO_PinGroup;
+
+// client event signaled when (data & mask) == pattern changes truth, see GPIO_TRIGGER_* in gpio.h
+#define GPIO_TRIGGER_MAX 4
+
+typedef struct {
+	u32 mask;
+	u32 pattern;
+	u32 signals;
+	Handle event;
+	u8 mode;
+	bool matched;
+	bool lost; // all of its interrupt bits were bound by clients at some point, see GPIO_TRIGGER_LOST
+} GPIO_Trigger;
+
+// timed GPIO data script, see GPIO_SEQ_* in gpio.h for the encoding
+typedef struct {
+	u32 words[GPIO_SEQ_MAX_WORDS];
+	TimerNode node;
+	u64 deadline; // wake up for the current wait
+	u64 timeout;  // level wait gives up here
+	Handle event; // signaled once done or failed
+	Result res;
+	u8 length;
+	u8 pc;
+	u8 step;
+	u8 state;
+	bool waiting;
+} GPIO_Sequence;
+
+// token bucket kept as the time it's full again, a session is parked out of the wait set
+// once its next request wouldn't fit, so that request waits in the kernel instead of being served
+typedef struct {
+	TimerNode node; // unparks the session
+	u64 full_at;
+	u32 served;
+	u32 throttled;
+	bool parked;
+} GPIO_RateBucket;
+
+typedef struct {
+	u32 service_bitmask;
+	u32 measure_mask;
+	bool in_transaction;
+	u8 group_usage;
+	u8 service; // index in GPIO_ServiceNames
+	u8 trigger_usage;
+	u32 trigger_mask; // bits any of the triggers look at
+	GPIO_Trigger* triggers[GPIO_TRIGGER_MAX];
+	GPIO_RateBucket rate;
+	GPIO_Transaction transaction;
+	GPIO_PinGroup* groups[GPIO_PIN_GROUP_MAX];
+	GPIO_Sequence* sequence; // NULL until the first RunSequence, kept for the status after that
+} GPIO_Session;
+
+static GPIO_Session GPIO_Sessions[GPIO_SESSION_MAX];
+static u32 GPIO_SessionUsage = 0;
+
+// pin groups and scripts come out of pools in one arena, each pool has a budget checked at build time
+// the defaults can hold as much as every session could use, lower them to keep the module smaller
+#ifndef GPIO_PIN_GROUP_POOL
+#define GPIO_PIN_GROUP_POOL (GPIO_SESSION_MAX * GPIO_PIN_GROUP_MAX)
+#endif
+#ifndef GPIO_SEQUENCE_POOL
+#define GPIO_SEQUENCE_POOL GPIO_SESSION_MAX
+#endif
+#ifndef GPIO_TRIGGER_POOL
+#define GPIO_TRIGGER_POOL (GPIO_SESSION_MAX * GPIO_TRIGGER_MAX)
+#endif
+
+#define GPIO_PIN_GROUP_BUDGET 4096
+#define GPIO_SEQUENCE_BUDGET  4096
+#define GPIO_TRIGGER_BUDGET   2048
+#define GPIO_ARENA_BUDGET     8192
+
+#define GPIO_PIN_GROUP_ARENA ARENA_POOL_SIZE(GPIO_PIN_GROUP_POOL, GPIO_PinGroup)
+#define GPIO_SEQUENCE_ARENA  ARENA_POOL_SIZE(GPIO_SEQUENCE_POOL, GPIO_Sequence)
+#define GPIO_TRIGGER_ARENA   ARENA_POOL_SIZE(GPIO_TRIGGER_POOL, GPIO_Trigger)
+#define GPIO_ARENA_SIZE      (GPIO_PIN_GROUP_ARENA + GPIO_SEQUENCE_ARENA + GPIO_TRIGGER_ARENA)
+
+_Static_assert(GPIO_PIN_GROUP_POOL <= 0xFFFF && GPIO_SEQUENCE_POOL <= 0xFFFF && GPIO_TRIGGER_POOL <= 0xFFFF, "pool counts are u16");
+_Static_assert(GPIO_PIN_GROUP_ARENA <= GPIO_PIN_GROUP_BUDGET, "GPIO_PIN_GROUP_POOL over its budget");
+_Static_assert(GPIO_SEQUENCE_ARENA <= GPIO_SEQUENCE_BUDGET, "GPIO_SEQUENCE_POOL over its budget");
+_Static_assert(GPIO_TRIGGER_ARENA <= GPIO_TRIGGER_BUDGET, "GPIO_TRIGGER_POOL over its budget");
+_Static_assert(GPIO_ARENA_SIZE <= GPIO_ARENA_BUDGET, "arena over its budget");
+
+static u8 GPIO_ArenaStorage[GPIO_ARENA_SIZE] ARENA_STORAGE;
+static Arena GPIO_Arena;
+static Pool GPIO_PinGroupPool;
+static Pool GPIO_SequencePool;
+static Pool GPIO_TriggerPool;
+
+static void GPIO_ArenaInit() {
+	Arena_Init(&GPIO_Arena, GPIO_ArenaStorage, sizeof(GPIO_ArenaStorage));
+	if (!Pool_Init(&GPIO_PinGroupPool, &GPIO_Arena, sizeof(GPIO_PinGroup), GPIO_PIN_GROUP_POOL) ||
+		!Pool_Init(&GPIO_SequencePool, &GPIO_Arena, sizeof(GPIO_Sequence), GPIO_SEQUENCE_POOL) ||
+		!Pool_Init(&GPIO_TriggerPool, &GPIO_Arena, sizeof(GPIO_Trigger), GPIO_TRIGGER_POOL))
+		Err_Throw(GPIO_INTERNAL_RANGE);
+}
+
+// set while a request from a session in a transaction is handled, writes go here instead of IO
+static GPIO_Transaction* GPIO_ActiveTransaction = NULL;
+
+inline static u8 GPIO_AllocSession(u32 service_bitmask, u8 service) {
+	u8 slot;
+	for (slot = 0; GPIO_SessionUsage & BIT(slot); slot++) {}
+	GPIO_SessionUsage |= BIT(slot);
+	GPIO_Sessions[slot].service_bitmask = service_bitmask;
+	GPIO_Sessions[slot].service = service;
+	GPIO_Sessions[slot].rate.full_at = 0;
+	GPIO_Sessions[slot].rate.served = 0;
+	GPIO_Sessions[slot].rate.throttled = 0;
+	GPIO_Sessions[slot].rate.parked = false;
+	GPIO_Sessions[slot].measure_mask = 0;
+	GPIO_Sessions[slot].in_transaction = false;
+	GPIO_Sessions[slot].group_usage = 0;
+	GPIO_Sessions[slot].sequence = NULL;
+	GPIO_Sessions[slot].trigger_usage = 0;
+	GPIO_Sessions[slot].trigger_mask = 0;
+	return slot;
+}
+
+inline static void GPIO_FreeSession(u8 slot) {
+	GPIO_SessionUsage &= ~BIT(slot);
+}
+
+// constant folded once the Write_GPIO functions are inlined
+inline static u32 GPIO_TransactionSlot(const volatile void* io) {
+	if (io == &GPIO_REG1)
+		return 0;
+	else if (io == &GPIO_REG2)
+		return 1;
+	else if (io == &GPIO_REG3)
+		return 2;
+	else if (io == &GPIO_REG4)
+		return 3;
+	return 4;
+}
+
+inline static void GPIO_TransactionStage(const volatile void* io, u32 value, u32 mask) {
+	u32 slot = GPIO_TransactionSlot(io);
+	GPIO_ActiveTransaction->mask[slot] |= mask;
+	GPIO_ActiveTransaction->value[slot] = (GPIO_ActiveTransaction->value[slot] & ~mask) | (value & mask);
+}
+
+#ifdef GPIO_NONFATAL_CLIENT_ERRORS
+// failures a client can cause on purpose are logged here and its session dropped,
+// instead of the whole module going down through ERRF
+#define GPIO_ERROR_RING_SIZE 16
+
+typedef struct {
+	Result res;
+	u32 service_bitmask; // 0 when not tied to a session
+	u32 header;
+} GPIO_ClientError;
+
+static GPIO_ClientError GPIO_ErrorRing[GPIO_ERROR_RING_SIZE];
+static u32 GPIO_ClientErrorCount = 0;
+static Result GPIO_ClientFailure = 0;
+
+static void GPIO_LogClientError(Result res, u32 service_bitmask, u32 header) {
+	GPIO_ClientError* entry = &GPIO_ErrorRing[GPIO_ClientErrorCount++ % GPIO_ERROR_RING_SIZE];
+	entry->res = res;
+	entry->service_bitmask = service_bitmask;
+	entry->header = header;
+}
+
+// total count, then the logged entries oldest first, 3 words each: result, service bitmask and request header
+static Result GPIO_GetClientErrors(u32* out, u32* words) {
+	u32 count = GPIO_ClientErrorCount;
+	u32 first = count > GPIO_ERROR_RING_SIZE ? count - GPIO_ERROR_RING_SIZE : 0;
+
+	out[0] = count;
+	*words = 1;
+	for (u32 i = first; i < count; i++) {
+		GPIO_ClientError* entry = &GPIO_ErrorRing[i % GPIO_ERROR_RING_SIZE];
+		out[(*words)++] = entry->res;
+		out[(*words)++] = entry->service_bitmask;
+		out[(*words)++] = entry->header;
+	}
+
+	return 0;
+}
+
+inline static Result GPIO_ClientFault(Result failure) {
+	GPIO_ClientFailure = failure;
+	return failure;
+}
+
+#define Client_FailedThrow(failure) do {Result __tmp = failure; if (R_FAILED(__tmp)) return GPIO_ClientFault(__tmp);} while(0)
+#else
+#define Client_FailedThrow(failure) Err_FailedThrow(failure)
+#endif
+
 inline static u32 Read_GPIO16(vu16* io, u32 mask, u32 access_mask, s8 left_shift) {
 	u32 value = *io;
 	mask &= access_mask;
@@ -98,7 +444,10 @@ inline static void Write_GPIO16(vu16* io, u32 value, u32 mask, u32 access_mask,
 		value <<= left_shift;
 		mask  <<= left_shift;
 	}
-	*io = (*io & ~mask) | (value & mask);
+	if (GPIO_ActiveTransaction)
+		GPIO_TransactionStage(io, value, mask);
+	else
+		*io = (*io & ~mask) | (value & mask);
 }
 
 inline static u32 Read_GPIO32(vu32* io, u32 mask, u32 access_mask, s8 left_shift) {
@@ -120,7 +469,36 @@ inline static void Write_GPIO32(vu32* io, u32 value, u32 mask, u32 access_mask,
 		value <<= left_shift;
 		mask  <<= left_shift;
 	}
-	*io = (*io & ~mask) | (value & mask);
+	if (GPIO_ActiveTransaction)
+		GPIO_TransactionStage(io, value, mask);
+	else
+		*io = (*io & ~mask) | (value & mask);
+}
+
+// ARM11 system tick rate, conversions are 16.16 fixed point
+// the module has no libgcc, so no 64 bit division outside of GPIO_Div64
+#define SYSCLOCK_ARM11 268111856
+
+inline static u64 GPIO_UsToTicks(u32 us) {
+	return ((u64)us * 17570979) >> 16;
+}
+
+inline static s64 GPIO_TicksToNs(u64 ticks) {
+	return (s64)((ticks * 244435) >> 16);
+}
+
+// restoring division, only for queries where the cost doesn't matter
+static u64 GPIO_Div64(u64 n, u64 d) {
+	u64 q = 0;
+	u64 r = 0;
+	for (s32 i = 63; i >= 0; i--) {
+		r = (r << 1) | ((n >> i) & 1);
+		if (r >= d) {
+			r -= d;
+			q |= (u64)1 << i;
+		}
+	}
+	return q;
 }
 
 // names for the IPC functions based off on 3dbrew named them
@@ -129,7 +507,7 @@ static Result GPIO_GetRegPart1(u32 service_bitmask, u32 mask, u32* value) {
 	*value = 0;
 	if (mask & ~service_bitmask)
 		return GPIO_NOT_AUTHORIZED;
-	if (mask & ~(GPIO_ACCESS_REG1 | GPIO_ACCESS_REG3))
+	if (mask & ~GPIO_REGPART1_BITS)
 		return GPIO_NOT_FOUND;
 	if (mask & GPIO_ACCESS_REG1) {
 		*value |= Read_GPIO32(&GPIO_REG1, mask, GPIO_ACCESS_REG1, -5);
@@ -144,7 +522,7 @@ static Result GPIO_GetRegPart1(u32 service_bitmask, u32 mask, u32* value) {
 static Result GPIO_SetRegPart1(u32 service_bitmask, u32 mask, u32 value) {
 	if (mask & ~service_bitmask)
 		return GPIO_NOT_AUTHORIZED;
-	if (mask & ~(GPIO_ACCESS_REG1 | GPIO_ACCESS_REG3))
+	if (mask & ~GPIO_REGPART1_BITS)
 		return GPIO_NOT_FOUND;
 	if (mask & GPIO_ACCESS_REG1) {
 		Write_GPIO32(&GPIO_REG1, value, mask, GPIO_ACCESS_REG1, 5);
@@ -153,6 +531,8 @@ static Result GPIO_SetRegPart1(u32 service_bitmask, u32 mask, u32 value) {
 		Write_GPIO32(&GPIO_REG3, value, mask, GPIO_ACCESS_REG3, 10);
 	}
 
+	GPIO_Changed();
+
 	return 0;
 }
 
@@ -160,7 +540,7 @@ static Result GPIO_GetRegPart2(u32 service_bitmask, u32 mask, u32* value) {
 	*value = 0;
 	if (mask & ~service_bitmask)
 		return GPIO_NOT_AUTHORIZED;
-	if (mask & ~(GPIO_ACCESS_REG1 | GPIO_ACCESS_REG4))
+	if (mask & ~GPIO_REGPART2_BITS)
 		return GPIO_NOT_FOUND;
 
 	if (mask & GPIO_ACCESS_REG1) {
@@ -176,7 +556,7 @@ static Result GPIO_GetRegPart2(u32 service_bitmask, u32 mask, u32* value) {
 static Result GPIO_SetRegPart2(u32 service_bitmask, u32 mask, u32 value) {
 	if (mask & ~service_bitmask)
 		return GPIO_NOT_AUTHORIZED;
-	if (mask & ~(GPIO_ACCESS_REG1 | GPIO_ACCESS_REG4))
+	if (mask & ~GPIO_REGPART2_BITS)
 		return GPIO_NOT_FOUND;
 
 	if (mask & GPIO_ACCESS_REG1) {
@@ -186,6 +566,8 @@ static Result GPIO_SetRegPart2(u32 service_bitmask, u32 mask, u32 value) {
 		Write_GPIO32(&GPIO_REG4, value, mask, GPIO_ACCESS_REG4, -6);
 	}
 
+	GPIO_Changed();
+
 	return 0;
 }
 
@@ -193,7 +575,7 @@ static Result GPIO_GetInterruptMask(u32 service_bitmask, u32 mask, u32* value) {
 	*value = 0;
 	if (mask & ~service_bitmask)
 		return GPIO_NOT_AUTHORIZED;
-	if (mask & ~(GPIO_ACCESS_REG1 | GPIO_ACCESS_REG4))
+	if (mask & ~GPIO_INTERRUPT_MASK_BITS)
 		return GPIO_NOT_FOUND;
 
 	if (mask & GPIO_ACCESS_REG1) {
@@ -209,7 +591,7 @@ static Result GPIO_GetInterruptMask(u32 service_bitmask, u32 mask, u32* value) {
 static Result GPIO_SetInterruptMask(u32 service_bitmask, u32 mask, u32 value) {
 	if (mask & ~service_bitmask)
 		return GPIO_NOT_AUTHORIZED;
-	if (mask & ~(GPIO_ACCESS_REG1 | GPIO_ACCESS_REG4))
+	if (mask & ~GPIO_INTERRUPT_MASK_BITS)
 		return GPIO_NOT_FOUND;
 
 	if (mask & GPIO_ACCESS_REG1) {
@@ -219,41 +601,44 @@ static Result GPIO_SetInterruptMask(u32 service_bitmask, u32 mask, u32 value) {
 		Write_GPIO32(&GPIO_REG4, value, mask, GPIO_ACCESS_REG4, 10);
 	}
 
+	GPIO_Changed();
+
 	return 0;
 }
 
-static Result GPIO_GetGPIOData(u32 service_bitmask, u32 mask, u32* value) {
-	*value = 0;
-	if (mask & ~service_bitmask)
-		return GPIO_NOT_AUTHORIZED;
-	if (mask & ~(GPIO_ACCESS_REG0 | GPIO_ACCESS_REG1 | GPIO_ACCESS_REG2 | GPIO_ACCESS_REG3 | GPIO_ACCESS_REG5))
-		return GPIO_NOT_FOUND;
-
+inline static u32 GPIO_ReadData(u32 mask) {
+	u32 value = 0;
 	if (mask & GPIO_ACCESS_REG0) {
-		*value |= Read_GPIO16(&GPIO_REG0, mask, GPIO_ACCESS_REG0, 0);
+		value |= Read_GPIO16(&GPIO_REG0, mask, GPIO_ACCESS_REG0, 0);
 	}
 	if (mask & GPIO_ACCESS_REG1) {
-		*value |= Read_GPIO32(&GPIO_REG1, mask, GPIO_ACCESS_REG1, 3);
+		value |= Read_GPIO32(&GPIO_REG1, mask, GPIO_ACCESS_REG1, 3);
 	}
 	if (mask & GPIO_ACCESS_REG2) {
-		*value |= Read_GPIO16(&GPIO_REG2, mask, GPIO_ACCESS_REG2, 5);
+		value |= Read_GPIO16(&GPIO_REG2, mask, GPIO_ACCESS_REG2, 5);
 	}
 	if (mask & GPIO_ACCESS_REG3) {
-		*value |= Read_GPIO32(&GPIO_REG3, mask, GPIO_ACCESS_REG3, 6);
+		value |= Read_GPIO32(&GPIO_REG3, mask, GPIO_ACCESS_REG3, 6);
 	}
 	if (mask & GPIO_ACCESS_REG5) {
-		*value |= Read_GPIO16(&GPIO_REG5, mask, GPIO_ACCESS_REG5, 18);
+		value |= Read_GPIO16(&GPIO_REG5, mask, GPIO_ACCESS_REG5, 18);
 	}
-
-	return 0;
+	return value;
 }
 
-static Result GPIO_SetGPIOData(u32 service_bitmask, u32 mask, u32 value) {
+static Result GPIO_GetGPIOData(u32 service_bitmask, u32 mask, u32* value) {
+	*value = 0;
 	if (mask & ~service_bitmask)
 		return GPIO_NOT_AUTHORIZED;
-	if (mask & ~(GPIO_ACCESS_REG1 | GPIO_ACCESS_REG2 | GPIO_ACCESS_REG3 | GPIO_ACCESS_REG5))
+	if (mask & ~GPIO_GET_DATA_BITS)
 		return GPIO_NOT_FOUND;
 
+	*value = GPIO_ReadData(mask);
+
+	return 0;
+}
+
+inline static void GPIO_WriteData(u32 mask, u32 value) {
 	if (mask & GPIO_ACCESS_REG1) {
 		Write_GPIO32(&GPIO_REG1, value, mask, GPIO_ACCESS_REG1, -3);
 	}
@@ -266,35 +651,574 @@ static Result GPIO_SetGPIOData(u32 service_bitmask, u32 mask, u32 value) {
 	if (mask & GPIO_ACCESS_REG5) {
 		Write_GPIO16(&GPIO_REG5, value, mask, GPIO_ACCESS_REG5, -18);
 	}
+	// PWM toggles don't go through GPIO_Changed
+	GPIO_SleepRefresh();
+}
+
+static Result GPIO_SetGPIOData(u32 service_bitmask, u32 mask, u32 value) {
+	if (mask & ~service_bitmask)
+		return GPIO_NOT_AUTHORIZED;
+	if (mask & ~GPIO_SET_DATA_BITS)
+		return GPIO_NOT_FOUND;
+
+	GPIO_WriteData(mask, value);
+
+	GPIO_Changed();
+
+	return 0;
+}
+
+static Result GPIO_BeginTransaction(GPIO_Session* session) {
+	if (session->in_transaction)
+		return GPIO_BUSY;
+
+	_memset32_aligned(session->transaction.mask, 0, sizeof(session->transaction.mask));
+	session->in_transaction = true;
+
+	return 0;
+}
+
+// one read-modify-write per touched register, REG1 interrupt enables apart, same order as wake restore
+// so all pins change together and no intermediate state reaches them
+static void GPIO_TransactionApply(const GPIO_Transaction* t) {
+	u32 reg1_mask = t->mask[0] & ~GPIO_REG1_INTERRUPT_BITS;
+	u32 reg1_interrupt_mask = t->mask[0] & GPIO_REG1_INTERRUPT_BITS;
+
+	if (t->mask[1])
+		GPIO_REG2 = (GPIO_REG2 & ~t->mask[1]) | (t->value[1] & t->mask[1]);
+	if (t->mask[4])
+		GPIO_REG5 = (GPIO_REG5 & ~t->mask[4]) | (t->value[4] & t->mask[4]);
+	if (t->mask[2])
+		GPIO_REG3 = (GPIO_REG3 & ~t->mask[2]) | (t->value[2] & t->mask[2]);
+	if (reg1_mask)
+		GPIO_REG1 = (GPIO_REG1 & ~reg1_mask) | (t->value[0] & reg1_mask);
+	if (t->mask[3])
+		GPIO_REG4 = (GPIO_REG4 & ~t->mask[3]) | (t->value[3] & t->mask[3]);
+	if (reg1_interrupt_mask)
+		GPIO_REG1 = (GPIO_REG1 & ~reg1_interrupt_mask) | (t->value[0] & reg1_interrupt_mask);
+
+	GPIO_Changed();
+}
+
+static Result GPIO_CommitTransaction(GPIO_Session* session) {
+	if (!session->in_transaction)
+		return GPIO_NO_TRANSACTION;
+
+	session->in_transaction = false;
+	GPIO_TransactionApply(&session->transaction);
+
+	return 0;
+}
+
+// staged like a client transaction, so the profile goes out as one write per register
+// the masks were checked against the variant's service bits at build time, so the Set* calls can't fail
+static void GPIO_ApplyBootProfile(const GPIO_BootProfile* profile, u32 service_bitmask) {
+	GPIO_ActiveBootProfile = profile;
+	if (!(profile->regpart1_mask | profile->regpart2_mask | profile->interrupt_mask_mask | profile->data_mask))
+		return;
+
+	GPIO_Transaction t;
+	_memset32_aligned(t.mask, 0, sizeof(t.mask));
+
+	GPIO_ActiveTransaction = &t;
+	GPIO_SetGPIOData(service_bitmask, profile->data_mask, profile->data);
+	GPIO_SetRegPart1(service_bitmask, profile->regpart1_mask, profile->regpart1);
+	GPIO_SetRegPart2(service_bitmask, profile->regpart2_mask, profile->regpart2);
+	GPIO_SetInterruptMask(service_bitmask, profile->interrupt_mask_mask, profile->interrupt_mask);
+	GPIO_ActiveTransaction = NULL;
+
+	GPIO_TransactionApply(&t);
+	GPIO_Features |= GPIO_FEATURE_BOOT_PROFILE;
+}
+
+// only the session's own bits, so a client can skip the Set* calls the profile already covers
+static Result GPIO_GetBootProfile(u32 service_bitmask, u32* out) {
+	const GPIO_BootProfile* profile = GPIO_ActiveBootProfile;
+	out[0] = profile->regpart1_mask & service_bitmask;
+	out[1] = profile->regpart1 & out[0];
+	out[2] = profile->regpart2_mask & service_bitmask;
+	out[3] = profile->regpart2 & out[2];
+	out[4] = profile->interrupt_mask_mask & service_bitmask;
+	out[5] = profile->interrupt_mask & out[4];
+	out[6] = profile->data_mask & service_bitmask;
+	out[7] = profile->data & out[6];
+	return 0;
+}
+
+inline static void GPIO_PinGroupAddStep(GPIO_PinGroup* group, const volatile void* io, bool wide, u32 access_mask, s8 left_shift) {
+	u32 mask = group->mask & access_mask;
+	if (!mask)
+		return;
+
+	GPIO_PinGroupStep* step = &group->steps[group->step_count++];
+	step->io = (uptr)io;
+	step->io_mask = left_shift < 0 ? mask << -left_shift : mask >> left_shift;
+	step->left_shift = left_shift;
+	step->wide = wide;
+}
+
+static Result GPIO_CreatePinGroup(GPIO_Session* session, u32 mask, u32* id) {
+	*id = 0;
+	if (mask & ~session->service_bitmask)
+		return GPIO_NOT_AUTHORIZED;
+	if (!mask || (mask & ~GPIO_GET_DATA_BITS))
+		return GPIO_NOT_FOUND;
+
+	u8 unused = ~session->group_usage;
+	if (!(unused & (BIT(GPIO_PIN_GROUP_MAX) - 1)))
+		return GPIO_BUSY;
+
+	GPIO_PinGroup* group = (GPIO_PinGroup*)Pool_Alloc(&GPIO_PinGroupPool);
+	if (!group)
+		return GPIO_BUSY;
+
+	u8 slot;
+	for (slot = 0; !(unused & BIT(slot)); slot++) {}
+
+	session->groups[slot] = group;
+	group->mask = mask;
+	group->step_count = 0;
+	group->writable = !(mask & ~GPIO_SET_DATA_BITS);
+	// same shifts as GPIO_ReadData, which GPIO_WriteData negates
+	GPIO_PinGroupAddStep(group, &GPIO_REG0, false, GPIO_ACCESS_REG0, 0);
+	GPIO_PinGroupAddStep(group, &GPIO_REG1, true,  GPIO_ACCESS_REG1, 3);
+	GPIO_PinGroupAddStep(group, &GPIO_REG2, false, GPIO_ACCESS_REG2, 5);
+	GPIO_PinGroupAddStep(group, &GPIO_REG3, true,  GPIO_ACCESS_REG3, 6);
+	GPIO_PinGroupAddStep(group, &GPIO_REG5, false, GPIO_ACCESS_REG5, 18);
+
+	session->group_usage |= BIT(slot);
+	*id = slot;
+
+	return 0;
+}
+
+inline static GPIO_PinGroup* GPIO_FindPinGroup(GPIO_Session* session, u32 id) {
+	if (id >= GPIO_PIN_GROUP_MAX || !(session->group_usage & BIT(id)))
+		return NULL;
+	return session->groups[id];
+}
+
+static Result GPIO_ReleasePinGroup(GPIO_Session* session, u32 id) {
+	GPIO_PinGroup* group = GPIO_FindPinGroup(session, id);
+	if (!group)
+		return GPIO_NOT_FOUND;
+	Pool_Free(&GPIO_PinGroupPool, group);
+	session->group_usage &= ~BIT(id);
+	return 0;
+}
+
+inline static void GPIO_PinGroupSessionClean(GPIO_Session* session) {
+	for (u8 id = 0; id < GPIO_PIN_GROUP_MAX; id++) {
+		if (session->group_usage & BIT(id))
+			Pool_Free(&GPIO_PinGroupPool, session->groups[id]);
+	}
+	session->group_usage = 0;
+}
+
+static Result GPIO_GetPinGroupData(GPIO_Session* session, u32 id, u32* value) {
+	*value = 0;
+	GPIO_PinGroup* group = GPIO_FindPinGroup(session, id);
+	if (!group)
+		return GPIO_NOT_FOUND;
+
+	for (u8 i = 0; i < group->step_count; i++) {
+		GPIO_PinGroupStep* step = &group->steps[i];
+		u32 io = (step->wide ? *(vu32*)step->io : *(vu16*)step->io) & step->io_mask;
+		*value |= step->left_shift < 0 ? io >> -step->left_shift : io << step->left_shift;
+	}
+
+	return 0;
+}
+
+static Result GPIO_SetPinGroupData(GPIO_Session* session, u32 id, u32 value) {
+	GPIO_PinGroup* group = GPIO_FindPinGroup(session, id);
+	if (!group || !group->writable)
+		return GPIO_NOT_FOUND;
+
+	for (u8 i = 0; i < group->step_count; i++) {
+		GPIO_PinGroupStep* step = &group->steps[i];
+		u32 io = step->left_shift < 0 ? value << -step->left_shift : value >> step->left_shift;
+		if (GPIO_ActiveTransaction)
+			GPIO_TransactionStage((const volatile void*)step->io, io, step->io_mask);
+		else if (step->wide)
+			*(vu32*)step->io = (*(vu32*)step->io & ~step->io_mask) | (io & step->io_mask);
+		else
+			*(vu16*)step->io = (*(vu16*)step->io & ~step->io_mask) | (io & step->io_mask);
+	}
+
+	GPIO_Changed();
+
+	return 0;
+}
+
+// every view of the session bits in one reply
+// configuration only changes through Set*, so it's skipped when the client's generation is current
+// input data can change without the module seeing it, so that one is always read
+static Result GPIO_GetState(u32 service_bitmask, u32 generation, u32* state) {
+	u32 current = GPIO_Generation;
+	state[0] = current;
+	state[1] = 0;
+	state[2] = 0;
+	state[3] = 0;
+	if (generation != current) {
+		GPIO_GetRegPart1(service_bitmask, service_bitmask & GPIO_REGPART1_BITS, &state[1]);
+		GPIO_GetRegPart2(service_bitmask, service_bitmask & GPIO_REGPART2_BITS, &state[2]);
+		GPIO_GetInterruptMask(service_bitmask, service_bitmask & GPIO_INTERRUPT_MASK_BITS, &state[3]);
+	}
+	return GPIO_GetGPIOData(service_bitmask, service_bitmask & GPIO_GET_DATA_BITS, &state[4]);
+}
+
+// one reply with everything a session can do, so clients don't have to probe with failing requests
+static Result GPIO_GetCapabilities(u32 service_bitmask, u32* caps) {
+	caps[0] = service_bitmask;
+	caps[1] = service_bitmask & GPIO_REGPART1_BITS;
+	caps[2] = service_bitmask & GPIO_REGPART2_BITS;
+	caps[3] = service_bitmask & GPIO_INTERRUPT_MASK_BITS;
+	caps[4] = service_bitmask & GPIO_GET_DATA_BITS;
+	caps[5] = service_bitmask & GPIO_SET_DATA_BITS;
+	caps[6] = service_bitmask & GPIO_BINDABLE_BITS;
+	caps[7] = GPIO_Features;
+
+	return 0;
+}
+
+// the module binds its own event to the interrupts of pins it wants to see edges on
+// client binds take priority, the module unbinds from a pin while a client has it
+#define GPIO_OBSERVE_PRIORITY 0x10
+
+static Handle GPIO_ObserveEvent;
+static u32 GPIO_ObserveBound = 0;  // bits bound to GPIO_ObserveEvent right now
+static u32 GPIO_ObserveWanted = 0; // bits some feature wants to see edges on
+static u32 GPIO_ObserveLevels = 0; // last sampled levels of the wanted bits
+static u64 GPIO_ObserveLastSample = 0;
+
+static void GPIO_ObserveSync() {
+	u32 wanted = GPIO_ObserveWanted & GPIO_BINDABLE_BITS & ~GPIO_BindHandleStoreUsage;
+	u32 change = wanted ^ GPIO_ObserveBound;
+
+	for (u8 bit = 0; bit < GPIO_BIND_MAX; bit++) {
+		u8 interrupt;
+		if (!(change & BIT(bit)) || R_FAILED(GPIO_MaskToInterrupt(BIT(bit), &interrupt)))
+			continue;
+		if (wanted & BIT(bit))
+			Err_FailedThrow(svcBindInterrupt(interrupt, GPIO_ObserveEvent, GPIO_OBSERVE_PRIORITY, false));
+		else
+			Err_FailedThrow(svcUnbindInterrupt(interrupt, GPIO_ObserveEvent));
+	}
+
+	GPIO_ObserveBound = wanted;
+}
+
+// a client is about to bind these bits
+inline static void GPIO_ObserveYield(u32 mask) {
+	u8 interrupt;
+	if (!(GPIO_ObserveBound & mask) || R_FAILED(GPIO_MaskToInterrupt(mask, &interrupt)))
+		return;
+	Err_FailedThrow(svcUnbindInterrupt(interrupt, GPIO_ObserveEvent));
+	GPIO_ObserveBound &= ~mask;
+}
+
+// pin measurement, times kept in ticks and only converted on query
+typedef struct {
+	u32 toggles;
+	u64 first_edge;
+	u64 last_edge;
+	u64 last_pulse;
+	u64 time_high;
+	u64 time_low;
+} GPIO_PinStats;
+
+static GPIO_PinStats GPIO_Stats[GPIO_BIND_MAX];
+static u32 GPIO_MeasureMask = 0;
+
+// only looks at triggers on bits that just toggled, the rest can't have changed truth
+// the whole mask is read again, it can have bits the observer doesn't sample or only just started to
+static void GPIO_TriggerEvaluate(u32 toggled) {
+	for (u8 i = 0; i < GPIO_SESSION_MAX; i++) {
+		GPIO_Session* session = &GPIO_Sessions[i];
+		if (!(GPIO_SessionUsage & BIT(i)) || !(session->trigger_mask & toggled))
+			continue;
+
+		for (u8 id = 0; id < GPIO_TRIGGER_MAX; id++) {
+			GPIO_Trigger* trigger = session->triggers[id];
+			if (!(session->trigger_usage & BIT(id)) || !(trigger->mask & toggled))
+				continue;
+
+			bool matched = !((GPIO_ReadData(trigger->mask) ^ trigger->pattern) & trigger->mask);
+			if (matched == trigger->matched)
+				continue;
+			trigger->matched = matched;
+			if (matched || trigger->mode == GPIO_TRIGGER_LEVEL) {
+				trigger->signals++;
+				svcSignalEvent(trigger->event);
+			}
+		}
+	}
+}
+
+// edges are only seen as the pin interrupts configure them, a pin toggling twice between samples isn't counted
+static void GPIO_ObserveSample(u64 now) {
+	u32 levels = GPIO_ReadData(GPIO_ObserveWanted);
+	u32 toggled = (levels ^ GPIO_ObserveLevels) & GPIO_ObserveWanted;
+	u64 elapsed = now - GPIO_ObserveLastSample;
+
+	// bits a client has bound aren't seen by the observer, their stats pause instead of making time up
+	u32 measured = GPIO_MeasureMask & ~GPIO_BindHandleStoreUsage;
+
+	for (u8 bit = 0; bit < GPIO_BIND_MAX; bit++) {
+		if (!(measured & BIT(bit)))
+			continue;
+		GPIO_PinStats* stats = &GPIO_Stats[bit];
+		if (GPIO_ObserveLevels & BIT(bit))
+			stats->time_high += elapsed;
+		else
+			stats->time_low += elapsed;
+		if (!(toggled & BIT(bit)))
+			continue;
+		if (!stats->toggles++)
+			stats->first_edge = now;
+		else
+			stats->last_pulse = now - stats->last_edge;
+		stats->last_edge = now;
+	}
+
+	GPIO_ObserveLevels = levels;
+	GPIO_ObserveLastSample = now;
+
+	if (toggled) {
+		GPIO_TriggerEvaluate(toggled);
+		GPIO_Changed();
+	}
+}
+
+static void GPIO_ObserveUpdate() {
+	u32 measured = 0;
+	u32 wanted = 0;
+	for (u8 i = 0; i < GPIO_SESSION_MAX; i++) {
+		if (!(GPIO_SessionUsage & BIT(i)))
+			continue;
+		measured |= GPIO_Sessions[i].measure_mask;
+		wanted |= GPIO_Sessions[i].measure_mask | GPIO_Sessions[i].trigger_mask;
+	}
+
+	u64 now = svcGetSystemTick();
+	GPIO_ObserveSample(now);
+
+	u32 started = measured & ~GPIO_MeasureMask;
+	for (u8 bit = 0; bit < GPIO_BIND_MAX; bit++) {
+		if (started & BIT(bit))
+			_memset32_aligned(&GPIO_Stats[bit], 0, sizeof(GPIO_PinStats));
+	}
+
+	GPIO_MeasureMask = measured;
+	GPIO_ObserveWanted = wanted;
+	GPIO_ObserveLevels = GPIO_ReadData(wanted);
+	GPIO_ObserveSync();
+}
+
+// measurement is shared, a bit is measured while any session wants it
+// starting measurement on a bit resets its counters
+static Result GPIO_SetMeasure(GPIO_Session* session, u32 mask, u32 value) {
+	if (mask & ~session->service_bitmask)
+		return GPIO_NOT_AUTHORIZED;
+	if (mask & ~GPIO_BINDABLE_BITS)
+		return GPIO_NOT_FOUND;
+
+	session->measure_mask = (session->measure_mask & ~mask) | (value & mask);
+	GPIO_ObserveUpdate();
+
+	return 0;
+}
+
+inline static void GPIO_TriggerUpdateMask(GPIO_Session* session) {
+	session->trigger_mask = 0;
+	for (u8 id = 0; id < GPIO_TRIGGER_MAX; id++) {
+		if (session->trigger_usage & BIT(id))
+			session->trigger_mask |= session->triggers[id]->mask;
+	}
+	GPIO_ObserveUpdate();
+}
+
+// the event is owned by the module until the trigger is removed
+// like measurement, the bits are seen through their interrupts, not while a client has them bound itself
+// bits without an interrupt are allowed next to at least one with, they're read whenever one of those toggles
+// level triggers are signaled right away when the condition already holds, edge ones only once it becomes true
+static Result GPIO_AddTrigger(GPIO_Session* session, u32 mask, u32 pattern, u32 mode, Handle event, u32* id) {
+	Result res = 0;
+	GPIO_Trigger* trigger = NULL;
+	u8 unused = ~session->trigger_usage;
+	*id = 0;
+
+	if (mask & ~session->service_bitmask)
+		res = GPIO_NOT_AUTHORIZED;
+	else if (!(mask & GPIO_BINDABLE_BITS) || (mask & ~GPIO_GET_DATA_BITS))
+		res = GPIO_NOT_FOUND;
+	else if (mode != GPIO_TRIGGER_EDGE && mode != GPIO_TRIGGER_LEVEL)
+		res = OS_INVALID_IPC_PARAMATER;
+	else if (!(mask & GPIO_BINDABLE_BITS & ~GPIO_BindHandleStoreUsage))
+		res = GPIO_BUSY; // nothing left the observer could see it through
+	else if (!(unused & (BIT(GPIO_TRIGGER_MAX) - 1)) || !(trigger = (GPIO_Trigger*)Pool_Alloc(&GPIO_TriggerPool)))
+		res = GPIO_BUSY;
+
+	if (R_FAILED(res)) {
+		svcCloseHandle(event);
+		return res;
+	}
+
+	u8 slot;
+	for (slot = 0; !(unused & BIT(slot)); slot++) {}
+
+	trigger->mask = mask;
+	trigger->pattern = pattern & mask;
+	trigger->signals = 0;
+	trigger->event = event;
+	trigger->mode = mode;
+	trigger->lost = false;
+	trigger->matched = !((GPIO_ReadData(mask) ^ pattern) & mask);
+	if (trigger->matched && mode == GPIO_TRIGGER_LEVEL) {
+		trigger->signals++;
+		svcSignalEvent(event);
+	}
+
+	session->triggers[slot] = trigger;
+	session->trigger_usage |= BIT(slot);
+	GPIO_TriggerUpdateMask(session);
+	*id = slot;
+
+	return 0;
+}
+
+inline static GPIO_Trigger* GPIO_FindTrigger(GPIO_Session* session, u32 id) {
+	if (id >= GPIO_TRIGGER_MAX || !(session->trigger_usage & BIT(id)))
+		return NULL;
+	return session->triggers[id];
+}
+
+static Result GPIO_RemoveTrigger(GPIO_Session* session, u32 id) {
+	GPIO_Trigger* trigger = GPIO_FindTrigger(session, id);
+	if (!trigger)
+		return GPIO_NOT_FOUND;
+
+	svcCloseHandle(trigger->event);
+	Pool_Free(&GPIO_TriggerPool, trigger);
+	session->trigger_usage &= ~BIT(id);
+	GPIO_TriggerUpdateMask(session);
+
+	return 0;
+}
+
+// current truth and how many times the event was signaled
+inline static bool GPIO_TriggerBlind(const GPIO_Trigger* trigger) {
+	return !(trigger->mask & GPIO_BINDABLE_BITS & ~GPIO_BindHandleStoreUsage);
+}
+
+// a client bind can take the last bit a trigger was observed through
+static void GPIO_TriggerBindCheck() {
+	for (u8 i = 0; i < GPIO_SESSION_MAX; i++) {
+		GPIO_Session* session = &GPIO_Sessions[i];
+		if (!(GPIO_SessionUsage & BIT(i)))
+			continue;
+		for (u8 id = 0; id < GPIO_TRIGGER_MAX; id++) {
+			if ((session->trigger_usage & BIT(id)) && GPIO_TriggerBlind(session->triggers[id]))
+				session->triggers[id]->lost = true;
+		}
+	}
+}
+
+// current truth, how many times the event was signaled, and GPIO_TRIGGER_BLIND/LOST flags
+static Result GPIO_GetTrigger(GPIO_Session* session, u32 id, u32* state) {
+	GPIO_Trigger* trigger = GPIO_FindTrigger(session, id);
+	state[0] = trigger ? trigger->matched : 0;
+	state[1] = trigger ? trigger->signals : 0;
+	state[2] = 0;
+	if (!trigger)
+		return GPIO_NOT_FOUND;
+	if (GPIO_TriggerBlind(trigger))
+		state[2] |= GPIO_TRIGGER_BLIND;
+	if (trigger->lost)
+		state[2] |= GPIO_TRIGGER_LOST;
+	return 0;
+}
+
+// the observer is updated by GPIO_CloseSession once the session is freed
+inline static void GPIO_TriggerSessionClean(GPIO_Session* session) {
+	for (u8 id = 0; id < GPIO_TRIGGER_MAX; id++) {
+		if (!(session->trigger_usage & BIT(id)))
+			continue;
+		svcCloseHandle(session->triggers[id]->event);
+		Pool_Free(&GPIO_TriggerPool, session->triggers[id]);
+	}
+	session->trigger_usage = 0;
+	session->trigger_mask = 0;
+}
+
+// 5 words per bit in ascending order: toggles, last pulse in us, average frequency in mHz, time high and low in ms
+// no service has more than 5 bits, so it always fits the command buffer
+// busy while a client has one of the bits bound, time spent like that isn't counted for either level
+static Result GPIO_GetPinStats(u32 service_bitmask, u32 mask, u32* out, u32* words) {
+	*words = 0;
+	if (mask & ~service_bitmask)
+		return GPIO_NOT_AUTHORIZED;
+	if (mask & ~GPIO_MeasureMask)
+		return GPIO_NOT_FOUND;
+	if (mask & GPIO_BindHandleStoreUsage)
+		return GPIO_BUSY;
+
+	GPIO_ObserveSample(svcGetSystemTick());
+
+	for (u8 bit = 0; bit < GPIO_BIND_MAX; bit++) {
+		if (!(mask & BIT(bit)))
+			continue;
+		GPIO_PinStats* stats = &GPIO_Stats[bit];
+		u64 span = stats->last_edge - stats->first_edge;
+		out[0] = stats->toggles;
+		out[1] = GPIO_Div64(stats->last_pulse * 125, SYSCLOCK_ARM11 / 8000);
+		// two toggles per period
+		out[2] = stats->toggles > 1 && span >= 1000 ? GPIO_Div64((u64)(stats->toggles - 1) * 500 * (SYSCLOCK_ARM11 / 1000), GPIO_Div64(span, 1000)) : 0;
+		out[3] = GPIO_Div64(stats->time_high, SYSCLOCK_ARM11 / 1000);
+		out[4] = GPIO_Div64(stats->time_low, SYSCLOCK_ARM11 / 1000);
+		out += 5;
+		*words += 5;
+	}
 
 	return 0;
 }
 
 static Result GPIO_BindInterrupt(u32 service_bitmask, u32 mask, Handle bind, s32 priority) {
 	if (!GPIO_IsBindFree(mask)) {
-		Err_FailedThrow(svcCloseHandle(bind));
+		Client_FailedThrow(svcCloseHandle(bind));
 		return GPIO_BUSY;
 	}
 
 	if (mask & ~service_bitmask) {
-		Err_FailedThrow(svcCloseHandle(bind));
+		Client_FailedThrow(svcCloseHandle(bind));
 		return GPIO_NOT_AUTHORIZED;
 	}
 
 	u8 interrupt;
 	Result res = GPIO_MaskToInterrupt(mask, &interrupt);
 	if (R_FAILED(res)) {
-		Err_FailedThrow(svcCloseHandle(bind));
+		Client_FailedThrow(svcCloseHandle(bind));
 		return res;
 	}
 
+	// measured time up to here still counts
+	if (GPIO_MeasureMask & mask)
+		GPIO_ObserveSample(svcGetSystemTick());
+	GPIO_ObserveYield(mask);
+
 	res = svcBindInterrupt(interrupt, bind, priority, false);
-	Err_FailedThrow(res);
+	if (R_FAILED(res)) {
+		svcCloseHandle(bind);
+		GPIO_ObserveSync();
+		Client_FailedThrow(res);
+	}
 
 	u8 bit;
 	for (bit = 0; mask != BIT(bit); bit++) {}
 
 	GPIO_StoreBind(bind, bit);
+	GPIO_TriggerBindCheck();
 
 	return res;
 }
@@ -302,38 +1226,417 @@ static Result GPIO_BindInterrupt(u32 service_bitmask, u32 mask, Handle bind, s32
 // v2048 -> v3073: They added svcCloseHandle calls on failed exits
 static Result GPIO_UnbindInterrupt(u32 service_bitmask, u32 mask, Handle bind) {
 	if (GPIO_IsBindFree(mask)) {
-		Err_FailedThrow(svcCloseHandle(bind));
+		Client_FailedThrow(svcCloseHandle(bind));
 		return GPIO_BUSY;
 	}
 
 	if (mask & ~service_bitmask) {
-		Err_FailedThrow(svcCloseHandle(bind));
+		Client_FailedThrow(svcCloseHandle(bind));
 		return GPIO_NOT_AUTHORIZED;
 	}
 
 	u8 interrupt;
 	Result res = GPIO_MaskToInterrupt(mask, &interrupt);
 	if (R_FAILED(res)) {
-		Err_FailedThrow(svcCloseHandle(bind));
+		Client_FailedThrow(svcCloseHandle(bind));
 		return res;
 	}
 
 	res = svcUnbindInterrupt(interrupt, bind);
-	Err_FailedThrow(res);
+	if (R_FAILED(res)) {
+		svcCloseHandle(bind);
+		Client_FailedThrow(res);
+	}
 
 	u8 bit;
 	for (bit = 0; mask != BIT(bit); bit++) {}
 
+	// sampled while still bound, so the time the bit was bound isn't counted
+	if (GPIO_MeasureMask & mask)
+		GPIO_ObserveSample(svcGetSystemTick());
 	GPIO_ReleaseBind(bit);
-	Err_FailedThrow(svcCloseHandle(bind));
+	GPIO_ObserveSync();
+	// triggers catch up on anything they missed while the bit was bound
+	GPIO_TriggerEvaluate(mask);
+	Client_FailedThrow(svcCloseHandle(bind));
 
 	return res;
 }
 
-static void GPIO_IPCSession(u32 service_bitmask) {
+// one shot, always armed for the earliest deadline on GPIO_Wheel
+static Handle GPIO_Timer;
+// everything time based is a node on this, GPIO_TimerNow is the time its callbacks run at
+static TimerWheel GPIO_Wheel;
+static u64 GPIO_TimerNow;
+
+static void GPIO_ScheduleTimer() {
+	u64 deadline = TimerWheel_Next(&GPIO_Wheel);
+
+	if (deadline == U64_MAX) {
+		Err_FailedThrow(svcCancelTimer(GPIO_Timer));
+		return;
+	}
+
+	u64 now = svcGetSystemTick();
+	Err_FailedThrow(svcSetTimer(GPIO_Timer, deadline > now ? GPIO_TicksToNs(deadline - now) : 0, 0));
+}
+
+// software PWM, the pin toggles are scheduled on GPIO_Wheel
+// lower periods than this aren't something the scheduler can keep up with
+#define GPIO_PWM_MIN_PERIOD_US 1000
+
+typedef struct {
+	TimerNode node;
+	u64 next;
+	u64 high_ticks;
+	u64 low_ticks;
+	bool level;
+	u8 owner; // session slot, PWM stops when it closes
+} GPIO_PWMPin;
+
+static GPIO_PWMPin GPIO_PWMPins[GPIO_BIND_MAX];
+static u32 GPIO_PWMActive = 0;
+// toggles collected over one wheel advance, written together by GPIO_TimerFired
+static u32 GPIO_PWMToggle = 0;
+static u32 GPIO_PWMValue = 0;
+
+// late toggles resync to now instead of bursting
+static void GPIO_PWMToggled(TimerNode* node) {
+	GPIO_PWMPin* pin = TimerWheel_Entry(node, GPIO_PWMPin, node);
+	u32 bit = BIT(pin - GPIO_PWMPins);
+
+	pin->level = !pin->level;
+	u64 ticks = pin->level ? pin->high_ticks : pin->low_ticks;
+	pin->next += ticks;
+	if (pin->next <= GPIO_TimerNow)
+		pin->next = GPIO_TimerNow + ticks;
+
+	GPIO_PWMToggle |= bit;
+	GPIO_PWMValue = pin->level ? GPIO_PWMValue | bit : GPIO_PWMValue & ~bit;
+	TimerWheel_Add(&GPIO_Wheel, node, pin->next);
+}
+
+inline static void GPIO_PWMStop(u32 mask) {
+	for (u8 bit = 0; bit < GPIO_BIND_MAX; bit++) {
+		if (mask & GPIO_PWMActive & BIT(bit))
+			TimerWheel_Cancel(&GPIO_Wheel, &GPIO_PWMPins[bit].node);
+	}
+	GPIO_PWMActive &= ~mask;
+}
+
+inline static void GPIO_PWMSessionClean(u8 slot) {
+	for (u8 bit = 0; bit < GPIO_BIND_MAX; bit++) {
+		if ((GPIO_PWMActive & BIT(bit)) && GPIO_PWMPins[bit].owner == slot)
+			GPIO_PWMStop(BIT(bit));
+	}
+}
+
+// period 0 stops PWM leaving the pins as they are, duty 0 or >= period holds them low or high
+// pins set in one call run in phase, all starting high
+// not staged by transactions, the timer toggles them directly anyway
+static Result GPIO_SetPWM(GPIO_Session* session, u32 mask, u32 period_us, u32 duty_us) {
+	if (mask & ~session->service_bitmask)
+		return GPIO_NOT_AUTHORIZED;
+	if (mask & ~GPIO_SET_DATA_BITS)
+		return GPIO_NOT_FOUND;
+	if (period_us && period_us < GPIO_PWM_MIN_PERIOD_US)
+		return GPIO_OUT_OF_RANGE;
+
+	GPIO_ActiveTransaction = NULL;
+	GPIO_PWMStop(mask);
+
+	if (!period_us || !duty_us || duty_us >= period_us) {
+		if (period_us)
+			GPIO_WriteData(mask, duty_us ? mask : 0);
+		GPIO_ScheduleTimer();
+		return 0;
+	}
+
+	u64 high_ticks = GPIO_UsToTicks(duty_us);
+	u64 low_ticks = GPIO_UsToTicks(period_us - duty_us);
+	u64 next = svcGetSystemTick() + high_ticks;
+	u8 slot = session - GPIO_Sessions;
+
+	for (u8 bit = 0; bit < GPIO_BIND_MAX; bit++) {
+		if (!(mask & BIT(bit)))
+			continue;
+		GPIO_PWMPin* pin = &GPIO_PWMPins[bit];
+		pin->next = next;
+		pin->high_ticks = high_ticks;
+		pin->low_ticks = low_ticks;
+		pin->level = true;
+		pin->owner = slot;
+		TimerNode_Init(&pin->node, GPIO_PWMToggled);
+		TimerWheel_Add(&GPIO_Wheel, &pin->node, next);
+	}
+
+	GPIO_WriteData(mask, mask);
+	GPIO_PWMActive |= mask;
+	GPIO_ScheduleTimer();
+
+	return 0;
+}
+
+// spin budget of one GPIO_SequenceRun call, shared by all its waits
+// waits ending within it are spun on in place, the rest go through GPIO_Wheel however short
+// so a script of many short waits can't hold the loop for longer than this at a time
+#define GPIO_SEQ_SPIN_US 100
+// level waits poll at this rate, not every pin has an interrupt to wake on
+#define GPIO_SEQ_POLL_US 250
+
+inline static u8 GPIO_SequenceOpLength(u32 op) {
+	return op == GPIO_SEQ_OP_WAIT_LEVEL ? 3 : 2;
+}
+
+// whole script is checked before anything runs, step is the op index that failed
+static Result GPIO_SequenceValidate(u32 service_bitmask, const u32* words, u32 length, u8* step) {
+	u32 pc = 0;
+	for (*step = 0; pc < length; (*step)++) {
+		u32 op = GPIO_SEQ_GET_OP(words[pc]);
+		u32 mask = GPIO_SEQ_GET_MASK(words[pc]);
+		if (op != GPIO_SEQ_OP_SET && op != GPIO_SEQ_OP_WAIT && op != GPIO_SEQ_OP_WAIT_LEVEL)
+			return OS_INVALID_IPC_PARAMATER;
+		if (pc + GPIO_SequenceOpLength(op) > length)
+			return OS_INVALID_IPC_PARAMATER;
+		if (mask & ~service_bitmask)
+			return GPIO_NOT_AUTHORIZED;
+		if (op == GPIO_SEQ_OP_SET && (mask & ~GPIO_SET_DATA_BITS))
+			return GPIO_NOT_FOUND;
+		if (op == GPIO_SEQ_OP_WAIT_LEVEL && (mask & ~GPIO_GET_DATA_BITS))
+			return GPIO_NOT_FOUND;
+		pc += GPIO_SequenceOpLength(op);
+	}
+	return 0;
+}
+
+static void GPIO_SequenceFinish(GPIO_Sequence* seq, Result res) {
+	seq->state = R_SUCCEEDED(res) ? GPIO_SEQ_DONE : GPIO_SEQ_FAILED;
+	seq->res = res;
+	svcSignalEvent(seq->event);
+	svcCloseHandle(seq->event);
+}
+
+// runs until the script ends or has to wait for the wheel
+static void GPIO_SequenceRun(GPIO_Sequence* seq, u64 now) {
+	u64 spin_end = now + GPIO_UsToTicks(GPIO_SEQ_SPIN_US);
+
+	while (seq->pc < seq->length) {
+		const u32* op = &seq->words[seq->pc];
+		u32 mask = GPIO_SEQ_GET_MASK(op[0]);
+
+		switch (GPIO_SEQ_GET_OP(op[0])) {
+		case GPIO_SEQ_OP_SET:
+			GPIO_WriteData(mask, op[1]);
+			GPIO_Changed();
+			break;
+		case GPIO_SEQ_OP_WAIT:
+			if (!seq->waiting) {
+				seq->deadline = now + GPIO_UsToTicks(op[1]);
+				if (seq->deadline <= spin_end) {
+					while ((now = svcGetSystemTick()) < seq->deadline) {}
+				} else {
+					seq->waiting = true;
+					TimerWheel_Add(&GPIO_Wheel, &seq->node, seq->deadline);
+					return;
+				}
+			} else if (now < seq->deadline) {
+				TimerWheel_Add(&GPIO_Wheel, &seq->node, seq->deadline);
+				return;
+			}
+			break;
+		case GPIO_SEQ_OP_WAIT_LEVEL:
+			if (!seq->waiting) {
+				seq->timeout = now + GPIO_UsToTicks(op[2]);
+				seq->waiting = true;
+			}
+			if ((GPIO_ReadData(mask) ^ op[1]) & mask) {
+				if (now >= seq->timeout) {
+					GPIO_SequenceFinish(seq, GPIO_TIMEOUT);
+					return;
+				}
+				seq->deadline = now + GPIO_UsToTicks(GPIO_SEQ_POLL_US);
+				if (seq->deadline > seq->timeout)
+					seq->deadline = seq->timeout;
+				TimerWheel_Add(&GPIO_Wheel, &seq->node, seq->deadline);
+				return;
+			}
+			break;
+		}
+
+		seq->waiting = false;
+		seq->pc += GPIO_SequenceOpLength(GPIO_SEQ_GET_OP(op[0]));
+		seq->step++;
+	}
+
+	GPIO_SequenceFinish(seq, 0);
+}
+
+static void GPIO_SequenceTimed(TimerNode* node) {
+	GPIO_SequenceRun(TimerWheel_Entry(node, GPIO_Sequence, node), GPIO_TimerNow);
+}
+
+inline static void GPIO_SequenceSessionClean(GPIO_Session* session) {
+	GPIO_Sequence* seq = session->sequence;
+	if (!seq)
+		return;
+	if (seq->state == GPIO_SEQ_RUNNING) {
+		TimerWheel_Cancel(&GPIO_Wheel, &seq->node);
+		svcCloseHandle(seq->event);
+	}
+	Pool_Free(&GPIO_SequencePool, seq);
+	session->sequence = NULL;
+}
+
+// one script per session at a time, the event is owned by the module until it's signaled
+// like PWM, the writes aren't staged by transactions
+static Result GPIO_RunSequence(GPIO_Session* session, const u32* words, u32 length, Handle event) {
+	GPIO_Sequence* seq = session->sequence;
+
+	if (!seq) {
+		seq = (GPIO_Sequence*)Pool_Alloc(&GPIO_SequencePool);
+		if (!seq) {
+			svcCloseHandle(event);
+			return GPIO_BUSY;
+		}
+		seq->state = GPIO_SEQ_IDLE;
+		session->sequence = seq;
+	}
+
+	if (seq->state == GPIO_SEQ_RUNNING) {
+		svcCloseHandle(event);
+		return GPIO_BUSY;
+	}
+
+	Result res = GPIO_SequenceValidate(session->service_bitmask, words, length, &seq->step);
+	if (R_FAILED(res)) {
+		svcCloseHandle(event);
+		seq->state = GPIO_SEQ_FAILED;
+		seq->res = res;
+		return res;
+	}
+
+	_memcpy32_aligned(seq->words, words, length * sizeof(u32));
+	seq->length = length;
+	seq->pc = 0;
+	seq->step = 0;
+	seq->waiting = false;
+	seq->deadline = 0;
+	seq->event = event;
+	seq->state = GPIO_SEQ_RUNNING;
+	TimerNode_Init(&seq->node, GPIO_SequenceTimed);
+
+	GPIO_ActiveTransaction = NULL;
+	GPIO_SequenceRun(seq, svcGetSystemTick());
+	GPIO_ScheduleTimer();
+
+	return 0;
+}
+
+static Result GPIO_GetSequenceStatus(GPIO_Session* session, u32* status) {
+	GPIO_Sequence* seq = session->sequence;
+	status[0] = seq ? seq->state : GPIO_SEQ_IDLE;
+	status[1] = seq ? seq->step : 0;
+	status[2] = seq && seq->state == GPIO_SEQ_FAILED ? (u32)seq->res : 0;
+	return 0;
+}
+
+// high water marks show how far the pool defaults could be lowered for a given set of clients
+static Result GPIO_GetMemoryStats(u32* stats) {
+	stats[0] = GPIO_Arena.size;
+	stats[1] = GPIO_Arena.used;
+	stats[2] = GPIO_PinGroupPool.count;
+	stats[3] = GPIO_PinGroupPool.high_water;
+	stats[4] = GPIO_SequencePool.count;
+	stats[5] = GPIO_SequencePool.high_water;
+	stats[6] = GPIO_TriggerPool.count;
+	stats[7] = GPIO_TriggerPool.high_water;
+	return 0;
+}
+
+// per service, filled from GPIO_ServiceRateLimits once so charging a request doesn't divide
+static u64 GPIO_RateCost[7];  // ticks a request takes out of the bucket, 0 when unlimited
+static u64 GPIO_RateSlack[7]; // how far full_at can be ahead of now with the next request still fitting
+static u32 GPIO_ServiceThrottles[7];
+// parked sessions are the last ones of the wait set
+static s32 GPIO_RateParked = 0;
+static bool GPIO_RateUnparked = false;
+
+static void GPIO_RateInit() {
+	for (u8 i = 0; i < sizeof(GPIO_ServiceRateLimits) / sizeof(GPIO_ServiceRateLimits[0]); i++) {
+		const GPIO_RateLimit* limit = &GPIO_ServiceRateLimits[i];
+		GPIO_RateCost[i] = limit->rate ? GPIO_Div64(SYSCLOCK_ARM11, limit->rate) : 0;
+		GPIO_RateSlack[i] = GPIO_RateCost[i] * (limit->burst ? limit->burst - 1 : 0);
+	}
+}
+
+static void GPIO_RateUnpark(TimerNode* node) {
+	TimerWheel_Entry(node, GPIO_RateBucket, node)->parked = false;
+	GPIO_RateUnparked = true;
+}
+
+// returns whether the session is over budget and has to be parked
+static bool GPIO_RateCharge(GPIO_Session* session) {
+	GPIO_RateBucket* rate = &session->rate;
+	u64 cost = GPIO_RateCost[session->service];
+	u64 slack = GPIO_RateSlack[session->service];
+
+	rate->served++;
+	if (!cost)
+		return false;
+
+	u64 now = svcGetSystemTick();
+	rate->full_at = (rate->full_at > now ? rate->full_at : now) + cost;
+	if (rate->full_at <= now + slack)
+		return false;
+
+	rate->parked = true;
+	rate->throttled++;
+	GPIO_ServiceThrottles[session->service]++;
+	TimerNode_Init(&rate->node, GPIO_RateUnpark);
+	TimerWheel_Add(&GPIO_Wheel, &rate->node, rate->full_at - slack);
+	GPIO_ScheduleTimer();
+	return true;
+}
+
+inline static void GPIO_RateSessionClean(GPIO_Session* session) {
+	if (!session->rate.parked)
+		return;
+	TimerWheel_Cancel(&GPIO_Wheel, &session->rate.node);
+	session->rate.parked = false;
+	GPIO_RateParked--;
+}
+
+static Result GPIO_GetRateStats(GPIO_Session* session, u32* stats) {
+	stats[0] = session->rate.served;
+	stats[1] = session->rate.throttled;
+	stats[2] = GPIO_ServiceThrottles[session->service];
+	stats[3] = GPIO_ServiceRateLimits[session->service].rate;
+	stats[4] = GPIO_ServiceRateLimits[session->service].burst;
+	return 0;
+}
+
+static void GPIO_TimerFired() {
+	GPIO_TimerNow = svcGetSystemTick();
+	TimerWheel_Advance(&GPIO_Wheel, GPIO_TimerNow);
+
+	if (GPIO_PWMToggle) {
+		GPIO_WriteData(GPIO_PWMToggle, GPIO_PWMValue);
+		GPIO_PWMToggle = 0;
+	}
+
+	GPIO_ScheduleTimer();
+}
+
+// while in a transaction, Set* requests are staged and Get* requests still read the IO as is
+// returns whether the session has to be dropped after the reply
+static bool GPIO_IPCSession(GPIO_Session* session) {
 	u32* cmdbuf = getThreadCommandBuffer();
+	u32 service_bitmask = session->service_bitmask;
+	u32 header = cmdbuf[0];
 	u32 value;
 
+	GPIO_ActiveTransaction = session->in_transaction ? &session->transaction : NULL;
+
 	switch (cmdbuf[0] >> 16) {
 	case 0x1:
 		cmdbuf[0] = IPC_MakeHeader(0x1, 2, 0);
@@ -389,13 +1692,128 @@ static void GPIO_IPCSession(u32 service_bitmask) {
 		cmdbuf[0] = IPC_MakeHeader(0xA, 1, 0);
 		cmdbuf[1] = GPIO_UnbindInterrupt(service_bitmask, cmdbuf[1], cmdbuf[3]);
 		break;
+	case 0xB:
+		cmdbuf[0] = IPC_MakeHeader(0xB, 9, 0);
+		cmdbuf[1] = GPIO_GetCapabilities(service_bitmask, &cmdbuf[2]);
+		break;
+	case 0xC:
+		cmdbuf[0] = IPC_MakeHeader(0xC, 6, 0);
+		cmdbuf[1] = GPIO_GetState(service_bitmask, cmdbuf[1], &cmdbuf[2]);
+		break;
+	case 0xD:
+		cmdbuf[0] = IPC_MakeHeader(0xD, 1, 0);
+		cmdbuf[1] = GPIO_BeginTransaction(session);
+		break;
+	case 0xE:
+		cmdbuf[0] = IPC_MakeHeader(0xE, 1, 0);
+		cmdbuf[1] = GPIO_CommitTransaction(session);
+		break;
+	case 0xF:
+		cmdbuf[0] = IPC_MakeHeader(0xF, 1, 0);
+		cmdbuf[1] = GPIO_SetPWM(session, cmdbuf[1], cmdbuf[2], cmdbuf[3]);
+		break;
+	case 0x10:
+		cmdbuf[0] = IPC_MakeHeader(0x10, 1, 0);
+		cmdbuf[1] = GPIO_SetMeasure(session, cmdbuf[2], cmdbuf[1]);
+		break;
+	case 0x11:
+		cmdbuf[1] = GPIO_GetPinStats(service_bitmask, cmdbuf[1], &cmdbuf[2], &value);
+		cmdbuf[0] = IPC_MakeHeader(0x11, 1 + value, 0);
+		break;
+	case 0x12:
+		cmdbuf[0] = IPC_MakeHeader(0x12, 2, 0);
+		cmdbuf[1] = GPIO_CreatePinGroup(session, cmdbuf[1], &value);
+		cmdbuf[2] = value;
+		break;
+	case 0x13:
+		cmdbuf[0] = IPC_MakeHeader(0x13, 2, 0);
+		cmdbuf[1] = GPIO_GetPinGroupData(session, cmdbuf[1], &value);
+		cmdbuf[2] = value;
+		break;
+	case 0x14:
+		cmdbuf[0] = IPC_MakeHeader(0x14, 1, 0);
+		cmdbuf[1] = GPIO_SetPinGroupData(session, cmdbuf[1], cmdbuf[2]);
+		break;
+	case 0x15:
+		cmdbuf[0] = IPC_MakeHeader(0x15, 1, 0);
+		cmdbuf[1] = GPIO_ReleasePinGroup(session, cmdbuf[1]);
+		break;
+	case 0x16:
+		value = cmdbuf[1];
+		if (value > GPIO_SEQ_MAX_WORDS || cmdbuf[0] != IPC_MakeHeader(0x16, value + 1, 2) || cmdbuf[value + 2] != IPC_Desc_SharedHandles(1)) {
+			cmdbuf[0] = IPC_MakeHeader(0x0, 1, 0);
+			cmdbuf[1] = OS_INVALID_IPC_PARAMATER;
+			break;
+		}
+		cmdbuf[0] = IPC_MakeHeader(0x16, 1, 0);
+		cmdbuf[1] = GPIO_RunSequence(session, &cmdbuf[2], value, cmdbuf[value + 3]);
+		break;
+	case 0x17:
+		cmdbuf[0] = IPC_MakeHeader(0x17, 4, 0);
+		cmdbuf[1] = GPIO_GetSequenceStatus(session, &cmdbuf[2]);
+		break;
+	case 0x18:
+		cmdbuf[0] = IPC_MakeHeader(0x18, 6, 0);
+		cmdbuf[1] = GPIO_GetRateStats(session, &cmdbuf[2]);
+		break;
+	case 0x19:
+		cmdbuf[0] = IPC_MakeHeader(0x19, 9, 0);
+		cmdbuf[1] = GPIO_GetMemoryStats(&cmdbuf[2]);
+		break;
+	case 0x1A:
+		if (cmdbuf[0] != IPC_MakeHeader(0x1A, 3, 2) || cmdbuf[4] != IPC_Desc_SharedHandles(1)) {
+			cmdbuf[0] = IPC_MakeHeader(0x0, 1, 0);
+			cmdbuf[1] = OS_INVALID_IPC_PARAMATER;
+			break;
+		}
+		cmdbuf[0] = IPC_MakeHeader(0x1A, 2, 0);
+		cmdbuf[1] = GPIO_AddTrigger(session, cmdbuf[1], cmdbuf[2], cmdbuf[3], cmdbuf[5], &value);
+		cmdbuf[2] = value;
+		break;
+	case 0x1B:
+		cmdbuf[0] = IPC_MakeHeader(0x1B, 1, 0);
+		cmdbuf[1] = GPIO_RemoveTrigger(session, cmdbuf[1]);
+		break;
+	case 0x1C:
+		cmdbuf[0] = IPC_MakeHeader(0x1C, 4, 0);
+		cmdbuf[1] = GPIO_GetTrigger(session, cmdbuf[1], &cmdbuf[2]);
+		break;
+	case 0x1D:
+		cmdbuf[0] = IPC_MakeHeader(0x1D, 9, 0);
+		cmdbuf[1] = GPIO_GetBootProfile(service_bitmask, &cmdbuf[2]);
+		break;
+#ifdef GPIO_NONFATAL_CLIENT_ERRORS
+	case 0x1E:
+		cmdbuf[1] = GPIO_GetClientErrors(&cmdbuf[2], &value);
+		cmdbuf[0] = IPC_MakeHeader(0x1E, 1 + value, 0);
+		break;
+#endif
 	default:
 		cmdbuf[0] = IPC_MakeHeader(0x0, 1, 0);
 		cmdbuf[1] = OS_INVALID_HEADER;
 	}
+
+	GPIO_ActiveTransaction = NULL;
+
+#ifdef GPIO_NONFATAL_CLIENT_ERRORS
+	if (R_FAILED(GPIO_ClientFailure)) {
+		GPIO_LogClientError(GPIO_ClientFailure, service_bitmask, header);
+		GPIO_ClientFailure = 0;
+		return true;
+	}
+#else
+	(void)header;
+#endif
+
+	return false;
 }
 
 static void GPIO_BindClosedSessionClean(u32 service_bitmask) {
+	// same as GPIO_UnbindInterrupt, the bound time isn't counted once the observer takes the bits back
+	u32 released = service_bitmask & GPIO_BindHandleStoreUsage;
+	if (GPIO_MeasureMask & released)
+		GPIO_ObserveSample(svcGetSystemTick());
+
 	for(u8 i = 0; i < GPIO_BIND_MAX; i++) {
 		u8 interrupt;
 		u32 mask = BIT(i);
@@ -405,6 +1823,62 @@ static void GPIO_BindClosedSessionClean(u32 service_bitmask) {
 		Err_FailedThrow(svcUnbindInterrupt(interrupt, GPIO_BindHandles[i]));
 		GPIO_ReleaseBind(i);
 	}
+	GPIO_TriggerEvaluate(released);
+}
+
+static s32 GPIO_CloseSession(Handle* session_handles, u8* session_slots, s32 handle_count, s32 remote_index, s32 index) {
+	svcCloseHandle(session_handles[index]);
+	GPIO_BindClosedSessionClean(GPIO_Sessions[session_slots[index - remote_index]].service_bitmask);
+	GPIO_PWMSessionClean(session_slots[index - remote_index]);
+	GPIO_SequenceSessionClean(&GPIO_Sessions[session_slots[index - remote_index]]);
+	GPIO_PinGroupSessionClean(&GPIO_Sessions[session_slots[index - remote_index]]);
+	GPIO_TriggerSessionClean(&GPIO_Sessions[session_slots[index - remote_index]]);
+	GPIO_RateSessionClean(&GPIO_Sessions[session_slots[index - remote_index]]);
+	GPIO_ScheduleTimer();
+	GPIO_FreeSession(session_slots[index - remote_index]);
+	GPIO_ObserveUpdate();
+	handle_count--;
+	for (s32 i = index - remote_index; i < handle_count - remote_index; i++) {
+		session_handles[remote_index + i] = session_handles[remote_index + i + 1];
+		session_slots[i] = session_slots[i + 1];
+	}
+	return handle_count;
+}
+
+inline static void GPIO_SwapSessions(Handle* session_handles, u8* session_slots, s32 remote_index, s32 a, s32 b) {
+	Handle handle = session_handles[a];
+	session_handles[a] = session_handles[b];
+	session_handles[b] = handle;
+
+	u8 slot = session_slots[a - remote_index];
+	session_slots[a - remote_index] = session_slots[b - remote_index];
+	session_slots[b - remote_index] = slot;
+}
+
+// moves the session to the front of the parked ones at the end, returns its new index
+static s32 GPIO_RatePark(Handle* session_handles, u8* session_slots, s32 handle_count, s32 remote_index, s32 index) {
+	s32 last_active = handle_count - GPIO_RateParked - 1;
+	GPIO_SwapSessions(session_handles, session_slots, remote_index, index, last_active);
+	GPIO_RateParked++;
+	return last_active;
+}
+
+// brings sessions unparked by the wheel back into the wait set, keeps the reply target index right
+static void GPIO_RateCompact(Handle* session_handles, u8* session_slots, s32 handle_count, s32 remote_index, s32* target_index) {
+	GPIO_RateUnparked = false;
+
+	for (s32 i = handle_count - GPIO_RateParked; i < handle_count; i++) {
+		if (GPIO_Sessions[session_slots[i - remote_index]].rate.parked)
+			continue;
+
+		s32 first_parked = handle_count - GPIO_RateParked;
+		GPIO_SwapSessions(session_handles, session_slots, remote_index, i, first_parked);
+		if (*target_index == i)
+			*target_index = first_parked;
+		else if (*target_index == first_parked)
+			*target_index = i;
+		GPIO_RateParked--;
+	}
 }
 
 static inline void initBSS() {
@@ -415,19 +1889,33 @@ static inline void initBSS() {
 
 void GPIOMain() {
 	initBSS();
+	GPIO_ArenaInit();
 	GPIO_InitIO();
 
 	bool is_pre_8x = osGetFirmVersion() < SYSTEM_VERSION(2, 44, 6);
 	const u32* GPIO_ServiceBitmasks = is_pre_8x ? GPIO_ServiceBitmasks_V0 : GPIO_ServiceBitmasks_V2048;
 	const s32 SERVICE_COUNT = is_pre_8x ? 5 : 7;
-	const s32 INDEX_MAX = SERVICE_COUNT * 2 + 1; // 11 pre 8.0, 15 post 8.0
-	const s32 REMOTE_SESSION_INDEX = SERVICE_COUNT + 1; // 6 pre 8.0, 8 post 8.0
+	const s32 INDEX_MAX = SERVICE_COUNT * 2 + 3; // 13 pre 8.0, 17 post 8.0
+	const s32 TIMER_INDEX = SERVICE_COUNT + 1; // 6 pre 8.0, 8 post 8.0
+	const s32 OBSERVE_INDEX = SERVICE_COUNT + 2; // 7 pre 8.0, 9 post 8.0
+	const s32 REMOTE_SESSION_INDEX = SERVICE_COUNT + 3; // 8 pre 8.0, 10 post 8.0
+
+	if (!is_pre_8x)
+		GPIO_Features |= GPIO_FEATURE_IR_MASK_GE_V2048;
+#ifdef GPIO_NONFATAL_CLIENT_ERRORS
+	GPIO_Features |= GPIO_FEATURE_NONFATAL_ERRORS;
+#endif
+
+	if (is_pre_8x)
+		GPIO_ApplyBootProfile(&GPIO_BootProfile_V0, GPIO_ALL_MASK_V0);
+	else
+		GPIO_ApplyBootProfile(&GPIO_BootProfile_V2048, GPIO_ALL_MASK_V2048);
 
-	Handle session_handles[15];
+	Handle session_handles[17];
 
-	u32 service_indexes[7];
+	u8 session_slots[GPIO_SESSION_MAX];
 
-	s32 handle_count = SERVICE_COUNT + 1;
+	s32 handle_count = SERVICE_COUNT + 3;
 
 	Err_FailedThrow(srvInit());
 
@@ -436,8 +1924,20 @@ void GPIOMain() {
 
 	Err_FailedThrow(srvEnableNotification(&session_handles[0]));
 
+	Err_FailedThrow(svcCreateTimer(&session_handles[TIMER_INDEX], RESET_ONESHOT));
+	GPIO_Timer = session_handles[TIMER_INDEX];
+	TimerWheel_Init(&GPIO_Wheel, svcGetSystemTick());
+	GPIO_RateInit();
+
+	Err_FailedThrow(svcCreateEvent(&session_handles[OBSERVE_INDEX], RESET_ONESHOT));
+	GPIO_ObserveEvent = session_handles[OBSERVE_INDEX];
+
+	for (u32 i = 0; i < sizeof(GPIO_SleepNotifications) / sizeof(GPIO_SleepNotifications[0]); i++)
+		Err_FailedThrow(srvSubscribe(GPIO_SleepNotifications[i]));
+
 	Handle target = 0;
 	s32 target_index = -1;
+	bool drop_target = false;
 	for (;;) {
 		s32 index;
 
@@ -448,41 +1948,65 @@ void GPIOMain() {
 				*getThreadCommandBuffer() = 0xFFFF0000;
 		}
 
-		Result res = svcReplyAndReceive(&index, session_handles, handle_count, target);
+		if (GPIO_RateUnparked)
+			GPIO_RateCompact(session_handles, session_slots, handle_count, REMOTE_SESSION_INDEX, &target_index);
+
+		Result res = svcReplyAndReceive(&index, session_handles, handle_count - GPIO_RateParked, target);
 		s32 last_target_index = target_index;
 		target = 0;
 		target_index = -1;
 
+		// the failure was replied above, anything else received from it is ignored
+		if (drop_target) {
+			drop_target = false;
+			handle_count = GPIO_CloseSession(session_handles, session_slots, handle_count, REMOTE_SESSION_INDEX, last_target_index);
+			if (index == last_target_index || (R_FAILED(res) && index == -1))
+				continue;
+			if (index > last_target_index)
+				index--;
+		}
+
 		if (R_FAILED(res)) {
 
 			if (res != OS_REMOTE_SESSION_CLOSED)
 				Err_Throw(res);
 
 			else if (index == -1) {
-				if (last_target_index == -1)
+				if (last_target_index == -1) {
+#ifdef GPIO_NONFATAL_CLIENT_ERRORS
+					GPIO_LogClientError(GPIO_CANCELED_RANGE, 0, 0);
+					continue;
+#else
 					Err_Throw(GPIO_CANCELED_RANGE);
-				else
+#endif
+				} else
 					index = last_target_index;
 			}
 
-			else if (index >= handle_count)
+			else if (index >= handle_count) {
+#ifdef GPIO_NONFATAL_CLIENT_ERRORS
+				GPIO_LogClientError(GPIO_CANCELED_RANGE, 0, 0);
+				continue;
+#else
 				Err_Throw(GPIO_CANCELED_RANGE);
-
-			svcCloseHandle(session_handles[index]);
-			GPIO_BindClosedSessionClean(GPIO_ServiceBitmasks[service_indexes[index - REMOTE_SESSION_INDEX]]);
-			handle_count--;
-			for (s32 i = index - REMOTE_SESSION_INDEX; i < handle_count - REMOTE_SESSION_INDEX; i++) {
-				session_handles[REMOTE_SESSION_INDEX + i] = session_handles[REMOTE_SESSION_INDEX + i + 1];
-				service_indexes[i] = service_indexes[i + 1];
+#endif
 			}
 
+			handle_count = GPIO_CloseSession(session_handles, session_slots, handle_count, REMOTE_SESSION_INDEX, index);
+
 			continue;
 		}
 
 		if (index == 0)
 			HandleSRVNotification();
 
-		else if (index >= 1 && index < REMOTE_SESSION_INDEX) {
+		else if (index == TIMER_INDEX)
+			GPIO_TimerFired();
+
+		else if (index == OBSERVE_INDEX)
+			GPIO_ObserveSample(svcGetSystemTick());
+
+		else if (index >= 1 && index < TIMER_INDEX) {
 			Handle newsession = 0;
 			Err_FailedThrow(svcAcceptSession(&newsession, session_handles[index]));
 
@@ -491,25 +2015,36 @@ void GPIOMain() {
 				continue;
 			}
 
+			// new sessions go before the parked ones
 			session_handles[handle_count] = newsession;
-			service_indexes[handle_count - REMOTE_SESSION_INDEX] = index - 1;
+			session_slots[handle_count - REMOTE_SESSION_INDEX] = GPIO_AllocSession(GPIO_ServiceBitmasks[index - 1], index - 1);
+			if (GPIO_RateParked)
+				GPIO_SwapSessions(session_handles, session_slots, REMOTE_SESSION_INDEX, handle_count, handle_count - GPIO_RateParked);
 			handle_count++;
 
 		} else if (index >= REMOTE_SESSION_INDEX && index < INDEX_MAX) {
-			GPIO_IPCSession(GPIO_ServiceBitmasks[service_indexes[index - REMOTE_SESSION_INDEX]]);
+			GPIO_Session* session = &GPIO_Sessions[session_slots[index - REMOTE_SESSION_INDEX]];
+			drop_target = GPIO_IPCSession(session);
 			target = session_handles[index];
 			target_index = index;
+			if (!drop_target && GPIO_RateCharge(session))
+				target_index = GPIO_RatePark(session_handles, session_slots, handle_count, REMOTE_SESSION_INDEX, index);
 
 		} else {
 			Err_Throw(GPIO_INTERNAL_RANGE);
 		}
 	}
 
+	for (u32 i = 0; i < sizeof(GPIO_SleepNotifications) / sizeof(GPIO_SleepNotifications[0]); i++)
+		Err_FailedThrow(srvUnsubscribe(GPIO_SleepNotifications[i]));
+
 	for (int i = 0; i < SERVICE_COUNT; i++) {
 		Err_FailedThrow(srvUnregisterService(GPIO_ServiceNames[i]));
 		svcCloseHandle(session_handles[i + 1]);
 	}
 
+	svcCloseHandle(session_handles[OBSERVE_INDEX]);
+	svcCloseHandle(session_handles[TIMER_INDEX]);
 	svcCloseHandle(session_handles[0]);
 
 	srvExit();
@@ -0,0 +1,257 @@
+#include <3ds/ipc.h>
+#include <3ds/result.h>
+#include <3ds/svc.h>
+#include <3ds/types.h>
+#include <gpio.h>
+#include <gpioc.h>
+
+static Result GPIOC_Send(Handle session) {
+	Result res = svcSendSyncRequest(session);
+	if (R_FAILED(res))
+		return res;
+	return getThreadCommandBuffer()[1];
+}
+
+static Result GPIOC_IPCGet(Handle session, u16 command, u32 mask, u32* value) {
+	u32* cmdbuf = getThreadCommandBuffer();
+	cmdbuf[0] = IPC_MakeHeader(command, 1, 0);
+	cmdbuf[1] = mask;
+
+	Result res = GPIOC_Send(session);
+	*value = R_SUCCEEDED(res) ? cmdbuf[2] : 0;
+	return res;
+}
+
+static Result GPIOC_IPCSet(Handle session, u16 command, u32 mask, u32 value) {
+	u32* cmdbuf = getThreadCommandBuffer();
+	cmdbuf[0] = IPC_MakeHeader(command, 2, 0);
+	cmdbuf[1] = value;
+	cmdbuf[2] = mask;
+
+	return GPIOC_Send(session);
+}
+
+inline static void GPIOC_CacheStore(GPIOC_Cache* cache, u32 mask, u32 value) {
+	cache->known |= mask;
+	cache->value = (cache->value & ~mask) | (value & mask);
+}
+
+inline static bool GPIOC_CacheMatches(const GPIOC_Cache* cache, u32 mask, u32 value) {
+	return !(mask & ~cache->known) && !((cache->value ^ value) & mask);
+}
+
+static Result GPIOC_FlushPending(GPIOC_Client* client, GPIOC_Cache* cache, GPIOC_Pending* pending, u16 command) {
+	if (!pending->mask)
+		return 0;
+
+	u32 mask = pending->mask;
+	pending->mask = 0;
+
+	Result res = GPIOC_IPCSet(client->session, command, mask, pending->value);
+	if (R_FAILED(res) && cache)
+		cache->known &= ~mask;
+	return res;
+}
+
+// keeps batching as is, used whenever a request needs the pending writes to be done first
+static Result GPIOC_FlushAll(GPIOC_Client* client) {
+	Result res = GPIOC_FlushPending(client, NULL, &client->pending_data, 0x8);
+	Result part = GPIOC_FlushPending(client, &client->regpart1, &client->pending_regpart1, 0x2);
+	if (R_SUCCEEDED(res))
+		res = part;
+	part = GPIOC_FlushPending(client, &client->regpart2, &client->pending_regpart2, 0x4);
+	if (R_SUCCEEDED(res))
+		res = part;
+	part = GPIOC_FlushPending(client, &client->interrupt_mask, &client->pending_interrupt_mask, 0x6);
+	if (R_SUCCEEDED(res))
+		res = part;
+
+	return res;
+}
+
+static Result GPIOC_CachedGet(GPIOC_Client* client, GPIOC_Cache* cache, GPIOC_Pending* pending, u16 command, u32 mask, u32* value) {
+	if (!(mask & ~cache->known)) {
+		*value = cache->value & mask;
+		return 0;
+	}
+
+	// the module would answer with the state from before the pending writes
+	if (pending->mask) {
+		Result res = GPIOC_FlushAll(client);
+		if (R_FAILED(res))
+			return res;
+	}
+
+	Result res = GPIOC_IPCGet(client->session, command, mask, value);
+	if (R_SUCCEEDED(res))
+		GPIOC_CacheStore(cache, mask, *value);
+	return res;
+}
+
+static Result GPIOC_CachedSet(GPIOC_Client* client, GPIOC_Cache* cache, GPIOC_Pending* pending, u16 command, u32 mask, u32 value) {
+	// pending writes are already in the cache, so this also drops repeats within a batch
+	if (GPIOC_CacheMatches(cache, mask, value))
+		return 0;
+
+	if (client->batching) {
+		pending->mask |= mask;
+		pending->value = (pending->value & ~mask) | (value & mask);
+		GPIOC_CacheStore(cache, mask, value);
+		return 0;
+	}
+
+	Result res = GPIOC_IPCSet(client->session, command, mask, value);
+	if (R_SUCCEEDED(res))
+		GPIOC_CacheStore(cache, mask, value);
+	else
+		cache->known &= ~mask;
+	return res;
+}
+
+Result GPIOC_Init(GPIOC_Client* client, Handle session) {
+	client->session = session;
+	client->service_bitmask = 0;
+	client->features = 0;
+	client->generation = 0;
+	client->batching = false;
+	client->regpart1.known = 0;
+	client->regpart2.known = 0;
+	client->interrupt_mask.known = 0;
+	client->pending_regpart1.mask = 0;
+	client->pending_regpart2.mask = 0;
+	client->pending_interrupt_mask.mask = 0;
+	client->pending_data.mask = 0;
+
+	u32* cmdbuf = getThreadCommandBuffer();
+	cmdbuf[0] = IPC_MakeHeader(0xB, 0, 0);
+
+	Result res = svcSendSyncRequest(session);
+	if (R_FAILED(res))
+		return res;
+
+	// stock gpio doesn't have it, plain requests still work
+	if (R_SUCCEEDED((Result)cmdbuf[1])) {
+		client->service_bitmask = cmdbuf[2];
+		client->features = cmdbuf[9];
+	}
+
+	return 0;
+}
+
+Result GPIOC_Refresh(GPIOC_Client* client) {
+	Result res = GPIOC_FlushAll(client);
+	if (R_FAILED(res))
+		return res;
+
+	if (!(client->features & GPIO_FEATURE_STATE_SNAPSHOT)) {
+		client->regpart1.known = 0;
+		client->regpart2.known = 0;
+		client->interrupt_mask.known = 0;
+		return 0;
+	}
+
+	u32* cmdbuf = getThreadCommandBuffer();
+	cmdbuf[0] = IPC_MakeHeader(0xC, 1, 0);
+	cmdbuf[1] = client->generation;
+
+	res = GPIOC_Send(client->session);
+	if (R_FAILED(res))
+		return res;
+
+	if (cmdbuf[2] != client->generation) {
+		u32 bitmask = client->service_bitmask;
+		client->generation = cmdbuf[2];
+		client->regpart1.known = bitmask & GPIO_REGPART1_BITS;
+		client->regpart1.value = cmdbuf[3];
+		client->regpart2.known = bitmask & GPIO_REGPART2_BITS;
+		client->regpart2.value = cmdbuf[4];
+		client->interrupt_mask.known = bitmask & GPIO_INTERRUPT_MASK_BITS;
+		client->interrupt_mask.value = cmdbuf[5];
+	}
+
+	return 0;
+}
+
+void GPIOC_BeginBatch(GPIOC_Client* client) {
+	client->batching = true;
+}
+
+Result GPIOC_Flush(GPIOC_Client* client) {
+	client->batching = false;
+	return GPIOC_FlushAll(client);
+}
+
+Result GPIOC_GetRegPart1(GPIOC_Client* client, u32 mask, u32* value) {
+	return GPIOC_CachedGet(client, &client->regpart1, &client->pending_regpart1, 0x1, mask, value);
+}
+
+Result GPIOC_SetRegPart1(GPIOC_Client* client, u32 mask, u32 value) {
+	return GPIOC_CachedSet(client, &client->regpart1, &client->pending_regpart1, 0x2, mask, value);
+}
+
+Result GPIOC_GetRegPart2(GPIOC_Client* client, u32 mask, u32* value) {
+	return GPIOC_CachedGet(client, &client->regpart2, &client->pending_regpart2, 0x3, mask, value);
+}
+
+Result GPIOC_SetRegPart2(GPIOC_Client* client, u32 mask, u32 value) {
+	return GPIOC_CachedSet(client, &client->regpart2, &client->pending_regpart2, 0x4, mask, value);
+}
+
+Result GPIOC_GetInterruptMask(GPIOC_Client* client, u32 mask, u32* value) {
+	return GPIOC_CachedGet(client, &client->interrupt_mask, &client->pending_interrupt_mask, 0x5, mask, value);
+}
+
+Result GPIOC_SetInterruptMask(GPIOC_Client* client, u32 mask, u32 value) {
+	return GPIOC_CachedSet(client, &client->interrupt_mask, &client->pending_interrupt_mask, 0x6, mask, value);
+}
+
+Result GPIOC_GetGPIOData(GPIOC_Client* client, u32 mask, u32* value) {
+	if (client->pending_data.mask) {
+		Result res = GPIOC_FlushAll(client);
+		if (R_FAILED(res))
+			return res;
+	}
+
+	return GPIOC_IPCGet(client->session, 0x7, mask, value);
+}
+
+Result GPIOC_SetGPIOData(GPIOC_Client* client, u32 mask, u32 value) {
+	GPIOC_Pending* pending = &client->pending_data;
+
+	if (client->batching) {
+		pending->mask |= mask;
+		pending->value = (pending->value & ~mask) | (value & mask);
+		return 0;
+	}
+
+	return GPIOC_IPCSet(client->session, 0x8, mask, value);
+}
+
+Result GPIOC_BindInterrupt(GPIOC_Client* client, u32 mask, Handle event, s32 priority) {
+	Result res = GPIOC_FlushAll(client);
+	if (R_FAILED(res))
+		return res;
+
+	u32* cmdbuf = getThreadCommandBuffer();
+	cmdbuf[0] = IPC_MakeHeader(0x9, 2, 2);
+	cmdbuf[1] = mask;
+	cmdbuf[2] = (u32)priority;
+	cmdbuf[3] = IPC_Desc_SharedHandles(1);
+	cmdbuf[4] = event;
+
+	return GPIOC_Send(client->session);
+}
+
+Result GPIOC_UnbindInterrupt(GPIOC_Client* client, u32 mask, Handle event) {
+	Result res = GPIOC_FlushAll(client);
+	if (R_FAILED(res))
+		return res;
+
+	u32* cmdbuf = getThreadCommandBuffer();
+	cmdbuf[0] = IPC_MakeHeader(0xA, 1, 2);
+	cmdbuf[1] = mask;
+	cmdbuf[2] = IPC_Desc_SharedHandles(1);
+	cmdbuf[3] = event;
+
+	return GPIOC_Send(client->session);
+}
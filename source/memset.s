@@ -0,0 +1,64 @@
+	.arch armv6k
+	.arm
+	.syntax unified
+
+@ 32 bytes per stm burst, then words, then bytes for the tail
+@ dest is expected word aligned, same as the C versions in memset.h
+
+	.section .text._memset32_burst, "ax", %progbits
+	.global _memset32_burst
+	.type   _memset32_burst, %function
+	.align  2
+_memset32_burst:
+	push    {r4-r8}
+	mov     r3, r1
+	mov     r4, r1
+	mov     r5, r1
+	mov     r6, r1
+	mov     r7, r1
+	mov     r8, r1
+	mov     r12, r1
+1:
+	subs    r2, r2, #32
+	stmhs   r0!, {r1, r3-r8, r12}
+	bhs     1b
+	add     r2, r2, #32
+2:
+	subs    r2, r2, #4
+	strhs   r1, [r0], #4
+	bhs     2b
+	add     r2, r2, #4
+3:
+	subs    r2, r2, #1
+	strbhs  r1, [r0], #1
+	bhs     3b
+	pop     {r4-r8}
+	bx      lr
+	.size   _memset32_burst, .-_memset32_burst
+
+	.section .text._memcpy32_burst, "ax", %progbits
+	.global _memcpy32_burst
+	.type   _memcpy32_burst, %function
+	.align  2
+_memcpy32_burst:
+	push    {r4-r9}
+1:
+	subs    r2, r2, #32
+	ldmhs   r1!, {r3-r9, r12}
+	stmhs   r0!, {r3-r9, r12}
+	bhs     1b
+	add     r2, r2, #32
+2:
+	subs    r2, r2, #4
+	ldrhs   r3, [r1], #4
+	strhs   r3, [r0], #4
+	bhs     2b
+	add     r2, r2, #4
+3:
+	subs    r2, r2, #1
+	ldrbhs  r3, [r1], #1
+	strbhs  r3, [r0], #1
+	bhs     3b
+	pop     {r4-r9}
+	bx      lr
+	.size   _memcpy32_burst, .-_memcpy32_burst
@@ -0,0 +1,137 @@
+#include <3ds/types.h>
+#include <timerwheel.h>
+
+// 32^4 wheel ticks
+#define TIMER_WHEEL_RANGE (1ULL << (TIMER_WHEEL_LEVEL_BITS * TIMER_WHEEL_LEVELS))
+
+// clz is a single instruction, ctz on 64 bits would pull in libgcc
+inline static u32 TimerWheel_LowestBit(u32 x) {
+	return 31 - __builtin_clz(x & -x);
+}
+
+static void TimerWheel_Link(TimerWheel* wheel, TimerNode* node) {
+	u64 at = node->expires;
+	u64 delta = at - wheel->now;
+	u8 level = 0;
+
+	if (delta >= TIMER_WHEEL_RANGE) {
+		at = wheel->now + TIMER_WHEEL_RANGE - 1;
+		level = TIMER_WHEEL_LEVELS - 1;
+	} else {
+		while (delta >> (TIMER_WHEEL_LEVEL_BITS * (level + 1)))
+			level++;
+	}
+
+	u8 slot = (at >> (TIMER_WHEEL_LEVEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+	TimerNode** head = &wheel->slots[level][slot];
+
+	node->level = level;
+	node->slot = slot;
+	node->next = *head;
+	node->pprev = head;
+	if (*head)
+		(*head)->pprev = &node->next;
+	*head = node;
+	wheel->occupied[level] |= BIT(slot);
+}
+
+// slots behind the current one belong to the next lap, those are covered by the boundary of the level above
+static u64 TimerWheel_NextTick(const TimerWheel* wheel) {
+	u64 next = U64_MAX;
+
+	for (u8 level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		if (!wheel->occupied[level])
+			continue;
+
+		u8 shift = TIMER_WHEEL_LEVEL_BITS * level;
+		u64 index = wheel->now >> shift;
+		u32 current = index & (TIMER_WHEEL_SLOTS - 1);
+		u32 ahead = wheel->occupied[level] & ~((2U << current) - 1);
+		u64 tick;
+
+		if (ahead)
+			tick = (index - current + TimerWheel_LowestBit(ahead)) << shift;
+		else
+			tick = ((index >> TIMER_WHEEL_LEVEL_BITS) + 1) << (shift + TIMER_WHEEL_LEVEL_BITS);
+
+		if (tick < next)
+			next = tick;
+	}
+
+	return next;
+}
+
+static void TimerWheel_Cascade(TimerWheel* wheel, u8 level) {
+	u8 slot = (wheel->now >> (TIMER_WHEEL_LEVEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+	TimerNode* node = wheel->slots[level][slot];
+
+	wheel->slots[level][slot] = NULL;
+	wheel->occupied[level] &= ~BIT(slot);
+
+	while (node) {
+		TimerNode* next = node->next;
+		TimerWheel_Link(wheel, node);
+		node = next;
+	}
+}
+
+void TimerWheel_Init(TimerWheel* wheel, u64 now) {
+	for (u8 level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		for (u8 slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+			wheel->slots[level][slot] = NULL;
+		wheel->occupied[level] = 0;
+	}
+	wheel->now = now >> TIMER_WHEEL_TICK_SHIFT;
+}
+
+void TimerWheel_Add(TimerWheel* wheel, TimerNode* node, u64 deadline) {
+	TimerWheel_Cancel(wheel, node);
+
+	u64 expires = (deadline >> TIMER_WHEEL_TICK_SHIFT) + ((deadline & ((1 << TIMER_WHEEL_TICK_SHIFT) - 1)) != 0);
+	node->expires = expires > wheel->now ? expires : wheel->now + 1;
+	TimerWheel_Link(wheel, node);
+}
+
+void TimerWheel_Cancel(TimerWheel* wheel, TimerNode* node) {
+	if (!node->pprev)
+		return;
+
+	*node->pprev = node->next;
+	if (node->next)
+		node->next->pprev = node->pprev;
+	if (!wheel->slots[node->level][node->slot])
+		wheel->occupied[node->level] &= ~BIT(node->slot);
+	node->pprev = NULL;
+}
+
+// jumps straight between ticks with work, boundaries skipped over only had empty slots to cascade
+void TimerWheel_Advance(TimerWheel* wheel, u64 now) {
+	now >>= TIMER_WHEEL_TICK_SHIFT;
+
+	while (wheel->now < now) {
+		u64 next = TimerWheel_NextTick(wheel);
+		if (next > now) {
+			wheel->now = now;
+			break;
+		}
+		wheel->now = next;
+
+		for (u8 level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+			if (!(next & ((1ULL << (TIMER_WHEEL_LEVEL_BITS * level)) - 1)))
+				TimerWheel_Cascade(wheel, level);
+		}
+
+		// a callback can't add to this slot again, anything it adds is at least a tick ahead
+		TimerNode** head = &wheel->slots[0][next & (TIMER_WHEEL_SLOTS - 1)];
+		while (*head) {
+			TimerNode* node = *head;
+			TimerWheel_Cancel(wheel, node);
+			node->callback(node);
+		}
+	}
+}
+
+u64 TimerWheel_Next(const TimerWheel* wheel) {
+	u64 next = TimerWheel_NextTick(wheel);
+	return next == U64_MAX ? next : next << TIMER_WHEEL_TICK_SHIFT;
+}